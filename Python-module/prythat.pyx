@@ -1,6 +1,7 @@
 # brapy.pyx - Python Module, this code will be translated to C by Cython.
 import sys
 import json
+from cpython.buffer cimport PyObject_GetBuffer, PyBuffer_Release, PyBUF_C_CONTIGUOUS, PyBUF_FORMAT
 
 ctypedef int (*f_type_intvoid)()
 ctypedef void (*f_type_int)(int)
@@ -45,9 +46,55 @@ cdef extern from "bracmat.h":
     cdef extern int startProc(startStruct * init)
     cdef extern void stringEval(const char * s,const char ** out,int * err)
     cdef extern void endProc()
-    
+    cdef extern void * ufpArray(const char * object, const char * array, int * elementsize, size_t * rank, size_t * shape, size_t maxrank, void ** pin)
+    cdef extern void ufpReleaseArray(void * pin)
+    cdef extern long ufpSetArray(const char * object, const char * array, const void * data, int elementsize, size_t rank, const size_t * shape)
+
+cdef enum:
+    MAXRANK = 64
+
+# True between init() and final()
+cdef bint running = False
+
+# The elements of an array of a UFP object, seen through the buffer protocol.
+# numpy.asarray() makes a view of the elements without copying them. As long as
+# the UFParray or a view of it exists, the UFP object is kept alive and tbl$,
+# bind and Die fail for the array. Views must not be used after final().
+cdef class UFParray:
+    cdef void * data
+    cdef void * pin
+    cdef int elementsize
+    cdef int rank
+    cdef Py_ssize_t shape[MAXRANK]
+    cdef Py_ssize_t strides[MAXRANK]
+
+    def __getbuffer__(self, Py_buffer * buffer, int flags):
+        cdef Py_ssize_t n = 1
+        cdef int k
+        for k in range(self.rank):
+            n *= self.shape[k]
+        buffer.buf = self.data
+        buffer.format = b'd' if self.elementsize == 8 else b'f'
+        buffer.internal = NULL
+        buffer.itemsize = self.elementsize
+        buffer.len = n * self.elementsize
+        buffer.ndim = self.rank
+        buffer.obj = self
+        buffer.readonly = 0
+        buffer.shape = self.shape
+        buffer.strides = self.strides
+        buffer.suboffsets = NULL
+
+    def __releasebuffer__(self, Py_buffer * buffer):
+        pass
+
+    def __dealloc__(self):
+        if self.pin != NULL and running:
+            ufpReleaseArray(self.pin)
+
 # Function to be called once, before the first call to HolyGrail() 
 def init():
+    global running
     cdef startStruct Init
     Init.WinIn = WinInFunc
     Init.WinOut = WinOutFunc
@@ -55,6 +102,7 @@ def init():
     Init.Ni = NiFunc
     Init.Nii = NiiFunc
     startProc(&Init)
+    running = True
 
 # Function to evaluate a Bracmat expression
 def HolyGrail(Str):
@@ -64,7 +112,50 @@ def HolyGrail(Str):
     cdef bytes py_string = Sout
     return py_string.decode('UTF-8')
 
+# Function that returns the array <Name> of the UFP object that is the value of
+# the Bracmat variable <Obj>, without copying, e.g.
+#   A = numpy.asarray(prythat.array("calc","A"))
+def array(Obj, Name):
+    cdef UFParray a = UFParray()
+    cdef size_t rank = 0
+    cdef size_t shape[MAXRANK]
+    cdef int k
+    a.data = ufpArray(bytes(Obj,'iso8859-1'), bytes(Name,'iso8859-1'), &a.elementsize, &rank, shape, MAXRANK, &a.pin)
+    if a.data == NULL or rank == 0 or rank > MAXRANK:
+        raise KeyError(Name)
+    a.rank = <int>rank
+    for k in range(a.rank):
+        a.shape[k] = <Py_ssize_t>shape[k]
+    a.strides[a.rank - 1] = a.elementsize
+    for k in range(a.rank - 1, 0, -1):
+        a.strides[k - 1] = a.strides[k] * a.shape[k]
+    return a
+
+# Function that copies the values of a NumPy array (or any other C-contiguous
+# buffer of doubles or floats) to the array <Name> of the UFP object that is the
+# value of the Bracmat variable <Obj>. The shapes must be equal. Returns the
+# number of elements.
+def setarray(Obj, Name, Values):
+    cdef Py_buffer view
+    cdef size_t shape[MAXRANK]
+    cdef long n = -1
+    cdef int k
+    PyObject_GetBuffer(Values, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT)
+    try:
+        fmt = view.format.lstrip(b'@=<' if sys.byteorder == 'little' else b'@=>')
+        if fmt in (b'd', b'f') and view.ndim <= MAXRANK:
+            for k in range(view.ndim):
+                shape[k] = <size_t>view.shape[k]
+            n = ufpSetArray(bytes(Obj,'iso8859-1'), bytes(Name,'iso8859-1'), view.buf, <int>view.itemsize, <size_t>view.ndim, shape)
+    finally:
+        PyBuffer_Release(&view)
+    if n < 0:
+        raise ValueError(Name)
+    return n
+
 # Function to be called after the last call to HolyGrail()
 def final():
+    global running
+    running = False
     endProc()
     
@@ -0,0 +1,52 @@
+#include "../singlesource/bracmat.h"
+#include <stdio.h>
+#include <time.h>
+
+/*
+Calls stringEval() many times with an expression whose result is thrown away,
+to compare the normal allocator with the evaluation arena (EVALUATIONARENA in
+defines01.h). 'make arena' in src/ builds and runs it both ways. By hand:
+
+    gcc -std=c99 -O2 -pthread -DNDEBUG -I../singlesource -DBRACMATEMBEDDED \
+        -DSINGLESOURCE -DEVALUATIONARENA=1 -o arenabench arenabench.c ../src/potu.c -lm
+*/
+
+#define CALLS 100000
+
+static int In(void)
+    {
+    return getchar();
+    }
+
+static void Out(int c)
+    {
+    putchar(c);
+    }
+
+static void Flush(void)
+    {
+    fflush(stdout);
+    }
+
+static startStruct StartStruct = { In,Out,Flush };
+
+int main(int argc, char* argv[])
+    {
+    int err = 0;
+    long i;
+    const char* out;
+    clock_t start;
+    startProc(&StartStruct);
+    start = clock();
+    for(i = 0; i < CALLS && !err; ++i)
+        {
+        stringEval("(a b c d e f g h):?x ?y&str$!y", &out, &err);
+        }
+    printf("%ld calls, %.0f ms, last result %s\n"
+           , i
+           , 1000.0 * (double)(clock() - start) / CLOCKS_PER_SEC
+           , err ? "(error)" : out
+    );
+    endProc();
+    return err;
+    }
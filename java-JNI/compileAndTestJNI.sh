@@ -61,6 +61,9 @@ jar cfv bracmat.jar dk/cst/bracmat.class
 
 popd
 # Compile the C code that exposes methods to Java.
+# (To let Java threads evaluate in parallel, each with its own interpreter,
+# add -DPER_THREAD_INTERPRETER to this command and to the one that compiles
+# bracmatso.c.)
 gcc -std=c99 -pedantic -Wall -pthread -c -fPIC -DNDEBUG -I$JAVA_HOME/include -I$JAVA_HOME/include/linux/ dk_cst_bracmat.c -o dk_cst_bracmat.o -lm
 # Link the two object files into a shared library (REALNAME).
 gcc -shared -Wl,-soname,libbracmat.so.1 -o libbracmat.so.1.0 bracmatso.o dk_cst_bracmat.o -lpthread -lm
@@ -11,13 +11,67 @@ pthread_mutex_t mutexinit = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t mutexend = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
-const char * out;
+#if defined PER_THREAD_INTERPRETER
+/* Compile this file and bracmat.c with -DPER_THREAD_INTERPRETER to give each
+   Java thread its own interpreter, so that calls of eval() from different
+   threads run in parallel. A thread's interpreter is started the first time
+   the thread calls init() or eval(). It evaluates the expression that was
+   passed to the first call of init(), e.g. to read the program file. end()
+   ends the interpreter of the calling thread. */
+#include <stdlib.h>
+#include <string.h>
+#if defined _MSC_VER
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL __thread
+#endif
+static char * initExpression = NULL;
+#else
+#define THREADLOCAL
+#endif
+
+THREADLOCAL const char * out;
+
+#if defined PER_THREAD_INTERPRETER
+static jint startInterpreter(void)
+    {
+    int err;
+    const char * expr;
+    jint ret = startProc(0);
+    if(ret == 1)
+        {
+#if defined WIN32
+        void mutexLockInit();
+        void mutexUnlockInit();
+        mutexLockInit();
+#else
+        pthread_mutex_lock( &mutexinit);
+#endif
+        expr = initExpression;
+#if defined WIN32
+        mutexUnlockInit();
+#else
+        pthread_mutex_unlock(&mutexinit);
+#endif
+        if(expr)
+            stringEval(expr,&out,&err); /*initialize, e.g. read program file*/
+        }
+    return ret;
+    }
+#endif
 
 JNIEXPORT jstring JNICALL Java_dk_cst_bracmat_eval(JNIEnv * env, jobject obj, jstring expr)
     {
     int err;
     jstring ret;
     const char * str;
+#if defined PER_THREAD_INTERPRETER
+    startInterpreter();
+    str = (*env)->GetStringUTFChars(env, expr, NULL);
+    stringEval(str,&out,&err);
+    ret = (*env)->NewStringUTF(env, out);
+    (*env)->ReleaseStringUTFChars(env, expr, str);
+#else
 #if defined WIN32
     void mutexLockOut();
     void mutexUnlockOut();
@@ -33,12 +87,36 @@ JNIEXPORT jstring JNICALL Java_dk_cst_bracmat_eval(JNIEnv * env, jobject obj, js
 #else
     (*env)->ReleaseStringUTFChars(env, expr, str);
     pthread_mutex_unlock(&mutexout);
+#endif
 #endif
     return ret;
     }
 
 JNIEXPORT jint JNICALL Java_dk_cst_bracmat_init(JNIEnv * env, jobject obj, jstring expr)
     {
+#if defined PER_THREAD_INTERPRETER
+    const char * str = (*env)->GetStringUTFChars(env, expr, NULL);
+#if defined WIN32
+    void mutexLockInit();
+    void mutexUnlockInit();
+    mutexLockInit();
+#else
+    pthread_mutex_lock( &mutexinit);
+#endif
+    if(!initExpression)
+        {
+        initExpression = (char *)malloc(strlen(str) + 1);
+        if(initExpression)
+            strcpy(initExpression, str);
+        }
+#if defined WIN32
+    mutexUnlockInit();
+#else
+    pthread_mutex_unlock(&mutexinit);
+#endif
+    (*env)->ReleaseStringUTFChars(env, expr, str);
+    return startInterpreter();
+#else
     int err;
     jint ret;
 #if defined WIN32
@@ -60,6 +138,7 @@ JNIEXPORT jint JNICALL Java_dk_cst_bracmat_init(JNIEnv * env, jobject obj, jstri
     pthread_mutex_unlock(&mutexinit);
 #endif
     return ret;
+#endif
     }
 
 JNIEXPORT void JNICALL Java_dk_cst_bracmat_end(JNIEnv * env, jobject obj)
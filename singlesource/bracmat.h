@@ -14,18 +14,34 @@ typedef struct startStruct
 #endif
     } startStruct;
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" int startProc(startStruct * init);
 extern "C" void /*int*/ stringEval(const char * s,const char ** out,int * err);
 /* 0 = FALSE, 1 = SUCCESS, otherwise FENCE */
 /* *out = "" if evaluation of s is a tree */
 extern "C" void endProc(void);
+extern "C" void * ufpArray(const char * object, const char * array, int * elementsize, size_t * rank, size_t * shape, size_t maxrank, void ** pin);
+/* Elements of an array of the UFP object that is the value of variable
+   <object>, not copied. 0 if there is no such array. The object and the
+   elements are kept until ufpReleaseArray(*pin) is called. */
+extern "C" void ufpReleaseArray(void * pin);
+extern "C" long ufpSetArray(const char * object, const char * array, const void * data, int elementsize, size_t rank, const size_t * shape);
+/* Copies doubles (elementsize 8) or floats (4) into such an array. */
 #else
 extern int startProc(startStruct * init);
 extern void /*int*/ stringEval(const char * s,const char ** out,int * err);
 /* 0 = FALSE, 1 = SUCCESS, otherwise FENCE */
 /* *out = "" if evaluation of s is a tree */
 extern void endProc(void);
+extern void * ufpArray(const char * object, const char * array, int * elementsize, size_t * rank, size_t * shape, size_t maxrank, void ** pin);
+/* Elements of an array of the UFP object that is the value of variable
+   <object>, not copied. 0 if there is no such array. The object and the
+   elements are kept until ufpReleaseArray(*pin) is called. */
+extern void ufpReleaseArray(void * pin);
+extern long ufpSetArray(const char * object, const char * array, const void * data, int elementsize, size_t rank, const size_t * shape);
+/* Copies doubles (elementsize 8) or floats (4) into such an array. */
 #endif
 
 #endif /* defined ALGEB_H */
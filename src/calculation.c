@@ -1,6 +1,10 @@
+#if (defined __unix__ || defined __APPLE__) && !defined _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE /* MAP_ANONYMOUS, for JITCOMPILE, and sysconf() */
+#endif
 #include "calculation.h"
 #include "variables.h"
 #include "nodedefs.h"
+#include "objectnode.h"
 #include "memory.h"
 #include "wipecopy.h"
 #include "input.h"
@@ -8,18 +12,51 @@
 #include "writeerr.h"
 #include "filewrite.h"
 #include "eval.h"
+#include "copy.h"
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include <float.h>
 
 #include "result.h" /* For debugging. Remove when done. */
 
+/* The JIT compiler emits x86-64 code for the System V calling convention. */
+#if JITCOMPILE && defined __x86_64__ && !defined _WIN32 && (defined __unix__ || defined __APPLE__)
+#include <sys/mman.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#else
+#undef JITCOMPILE
+#define JITCOMPILE 0
+#endif
+
+/* The batch method divides its work among POSIX threads. */
+#if CALCULATION_THREADS > 1 && (defined __unix__ || defined __APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#else
+#undef CALCULATION_THREADS
+#define CALCULATION_THREADS 1
+#endif
+
+/* The bind method maps the elements of an array onto a file. */
+#if defined __unix__ || defined __APPLE__
+#define MAPPEDARRAYS 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define MAPPEDARRAYS 0
+#endif
+
 #define TOINT(a) ((size_t)ceil(fabs(a)))
 
 typedef enum { epop, enopop } popping;
-static popping mustpop = enopop;
+static THREADLOCAL popping mustpop = enopop;
 
 typedef enum
     {
@@ -102,7 +139,22 @@ typedef enum
     , EIdx  /* !(idx$(<array name>,<index>,...)) */
     , Extent /* extent$(<array name>,d)) 0 <= d < rank, returns 0 if d < 0 or d >= array rank */
     , Rank  /* rank$(<array name>)) */
+    , Map    /* map$(<function>,<array name>,<array name or number>) */
+    , Zip    /* zip$(<function>,<array name>,<array name or number>,<array name or number>) */
+    , Reduce /* reduce$(<function>,<array name>) */
+    , Dot    /* dot$(<array name>,<array name>) */
     , Eval /* callback, evaluate normal Bracmat code */
+    , rMove       /* r = a                 register words, see registerize() */
+    , rPlus       /* r = a + b                                              */
+    , rTimes      /* r = a * b                                              */
+    , rSubtract   /* r = a - b                                              */
+    , rDivide     /* r = a / b                                              */
+    , rLess       /* jump if not a < b                                      */
+    , rLess_equal
+    , rMore_equal
+    , rMore
+    , rUnequal
+    , rEqual
     , NoOp
     } actionType;
 
@@ -186,15 +238,30 @@ static char* ActionAsWord[] =
     ,"Eidx"
     ,"extent"
     ,"rank"
+    ,"map"
+    ,"zip"
+    ,"reduce"
+    ,"dot"
     ,"eval"
+    ,"rMove"
+    ,"rPlus"
+    ,"rTimes"
+    ,"rSubtract"
+    ,"rDivide"
+    ,"r<"
+    ,"r<="
+    ,"r>="
+    ,"r>"
+    ,"r!="
+    ,"r=="
     ,"NoOp"
     };
 
 struct forthMemory;
 
 typedef psk(*exportfunct)(double x);
-static exportfunct xprtfnc;
-static const char* spec;
+static THREADLOCAL exportfunct xprtfnc;
+static THREADLOCAL const char* spec;
 
 typedef union forthvalue /* a number. either integer or 'real' */
     {
@@ -202,16 +269,22 @@ typedef union forthvalue /* a number. either integer or 'real' */
     /* LONG integer;*/
     } forthvalue;
 
+typedef enum { Float64, Float32 } elementType;
+
 typedef struct fortharray
     {
     char* name;
     struct fortharray* next;
-    forthvalue* pval;
+    forthvalue* pval; /* float* if type is Float32 */
+    elementType type; /* Float32 if declared with 'f' or created by ftbl$ */
+    void* mapping; /* file that pval points into, see bindArray() */
+    size_t mappingsize;
     size_t size;
     size_t index;
     size_t rank;
     size_t* extent;
     size_t* stride; /* Product of extents*/
+    size_t exported; /* views of pval held by an embedding program, see ufpArray() */
     } fortharray;
 
 typedef union stackvalue
@@ -221,6 +294,15 @@ typedef union stackvalue
     fortharray* arrp;
     } stackvalue;
 
+typedef struct regop /* operands of a register word */
+    {
+    forthvalue* a;
+    forthvalue* b;
+    forthvalue* r; /* result */
+    stackvalue* sp; /* the stack pointer after the word */
+    forthvalue k[2]; /* constant operands a and/or b */
+    } regop;
+
 typedef struct forthvariable
     {
     char* name;
@@ -257,7 +339,33 @@ static char* logics[] =
 
 struct forthMemory;
 
+typedef struct kernel /* what map$, zip$ and reduce$ do with each element */
+    {
+    actionType fun;
+    unsigned int scalars; /* bit k is set if operand k is a number, not an array */
+    } kernel;
+
 #define CALCULATION_PROFILING 0
+
+#if CALCULATION_PROFILING
+#undef JITCOMPILE
+#define JITCOMPILE 0
+#endif
+
+/* Direct threading needs labels as values, an extension of GCC and clang. */
+#if DIRECTTHREADING && !CALCULATION_PROFILING && (defined __GNUC__ || defined __clang__)
+#undef DIRECTTHREADING
+#define DIRECTTHREADING 1
+#define CALCWORD(action) L_##action
+#define NEXTWORD goto *(wordp->handler)
+#define PROFILEHANDLER (NoOp + 1) /* counts the word, then does its action */
+#else
+#undef DIRECTTHREADING
+#define DIRECTTHREADING 0
+#define CALCWORD(action) case action
+#define NEXTWORD break
+#endif
+
 typedef struct forthword
     {
 #if CALCULATION_PROFILING
@@ -267,10 +375,13 @@ typedef struct forthword
 #else
     actionType action;
     unsigned int offset; /* Interpreted as arity if action is Afunction */
+#endif
+#if DIRECTTHREADING
+    void* handler; /* Code in calculateBody() for action. Set by threadWords(). */
 #endif
     union
         {
-        fortharray* arrp; forthvalue* valp; forthvalue val; dumbl logic; struct forthMemory* that; psk Pnode /*callback*/;
+        fortharray* arrp; forthvalue* valp; forthvalue val; dumbl logic; struct forthMemory* that; psk Pnode /*callback*/; kernel krnl; regop* rop;
         } u;
     } forthword;
 
@@ -300,7 +411,18 @@ typedef struct forthMemory
     stackvalue* sp;
     parameter* parameters;
     size_t nparameters;
-    stackvalue stack[64];
+    stackvalue* stack; /* as deep as the code needs, see setStack() */
+    size_t stacksize;
+    regop* regops; /* operands of all register words */
+    unsigned long* counts; /* executions of each word, while profiling */
+    unsigned long calls; /* while profiling */
+    clock_t ticks; /* time spent in calls, while profiling */
+    psk source; /* code of the main calculation, for making twins */
+    struct forthMemory* twin; /* copy that another thread uses, see batch() */
+#if JITCOMPILE
+    unsigned char* jitcode; /* machine code for word, or 0 */
+    size_t jitsize;
+#endif
     } forthMemory;
 
 typedef struct Etriple
@@ -323,6 +445,28 @@ static void showProblematicNode(char* msg, psk node)
     errorprintf("\n");
     }
 
+#if CALCULATION_THREADS > 1
+static pthread_mutex_t errorMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void runtimeError(const char* fmt, ...)
+/* errorprintf() for errors while calculating, which can happen in several
+   threads at once, see batch(). */
+    {
+    char buffer[1000];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    va_end(ap);
+#if CALCULATION_THREADS > 1
+    pthread_mutex_lock(&errorMutex);
+#endif
+    errorprintf("%s", buffer);
+#if CALCULATION_THREADS > 1
+    pthread_mutex_unlock(&errorMutex);
+#endif
+    }
+
 static double drand(double extent)
     {
     return extent * (double)rand() / ((double)RAND_MAX + 1.0);
@@ -334,7 +478,7 @@ static char* getVarName(forthMemory* mem, forthvalue* val)
         {
         forthvariable* varp = mem->var;
         fortharray* arrp = mem->arr;
-        static char buffer[32];
+        static THREADLOCAL char buffer[32];
         for(; varp; varp = varp->next)
             {
             if(&(varp->val.floating) == &(val->floating))
@@ -342,7 +486,7 @@ static char* getVarName(forthMemory* mem, forthvalue* val)
             }
         for(; arrp; arrp = arrp->next)
             {
-            for(size_t i = 0; i < arrp->size; ++i)
+            for(size_t i = 0; arrp->type == Float64 && i < arrp->size; ++i)
                 if(&((arrp->pval + i)->floating) == &(val->floating))
                     {
                     sprintf(buffer, "%s[%zu]", arrp->name, i);
@@ -353,6 +497,25 @@ static char* getVarName(forthMemory* mem, forthvalue* val)
     return "UNK variable";
     }
 
+static char* regOperand(forthMemory* mem, regop* rop, forthvalue* val)
+/* Name of an operand of a register word: S<n> for a slot of the stack, a
+   number for a constant, otherwise the name of a variable. */
+    {
+    static THREADLOCAL char buffer[32];
+    stackvalue* slot = (stackvalue*)val;
+    if(slot >= mem->stack && slot < mem->stack + mem->stacksize)
+        {
+        sprintf(buffer, "S%d", (int)(slot - mem->stack));
+        return buffer;
+        }
+    if(val == rop->k || val == rop->k + 1)
+        {
+        sprintf(buffer, "%f", val->floating);
+        return buffer;
+        }
+    return getVarName(mem, val);
+    }
+
 static forthvariable* getVariablePointer(forthvariable* varp, char* name)
     {
     forthvariable* curvarp = varp;
@@ -389,15 +552,35 @@ static fortharray* getArrayPointer(fortharray** arrp, char* name)
     return curarrp;
     }
 
+static size_t elementSize(fortharray* arrp)
+    {
+    return arrp->type == Float32 ? sizeof(float) : sizeof(forthvalue);
+    }
+
+static double getElement(fortharray* arrp, size_t i)
+    {
+    if(arrp->type == Float32)
+        return (double)((float*)arrp->pval)[i];
+    return arrp->pval[i].floating;
+    }
+
+static void setElement(fortharray* arrp, size_t i, double val)
+    {
+    if(arrp->type == Float32)
+        ((float*)arrp->pval)[i] = (float)val;
+    else
+        arrp->pval[i].floating = val;
+    }
+
 Boolean initialise(fortharray* curarrp, size_t size)
     {
     curarrp->index = 0;
     assert(curarrp->pval == 0 || curarrp->size == size);
     if(curarrp->pval == 0)
-        curarrp->pval = (forthvalue*)bmalloc(size * sizeof(forthvalue));
+        curarrp->pval = (forthvalue*)bmalloc(size * elementSize(curarrp));
     if(curarrp->pval)
         {
-        memset(curarrp->pval, 0, size * sizeof(forthvalue));
+        memset(curarrp->pval, 0, size * elementSize(curarrp));
         curarrp->size = size;
         }
     else
@@ -465,7 +648,7 @@ static fortharray* getOrCreateArrayPointer(fortharray** arrp, char* name, size_t
             }
         else if(size > 0)
             {
-            memset(curarrp->pval, 0, size * sizeof(forthvalue));
+            memset(curarrp->pval, 0, size * elementSize(curarrp));
             curarrp->index = 0;
             }
         }
@@ -602,6 +785,13 @@ static stackvalue* fsetArgs(stackvalue* sp, int arity, forthMemory* thatmem)
             {
             fortharray* arrp = parms[Ndecl].u.a;
             fortharray* arr = sp->arrp;
+            if(arr->type != arrp->type)
+                {
+                runtimeError("Array \"%s\" has %s elements, parameter \"%s\" is declared with %s elements.\n"
+                             , arr->name, arr->type == Float32 ? "32-bit" : "64-bit"
+                             , arrp->name, arrp->type == Float32 ? "32-bit" : "64-bit");
+                return 0;
+                }
             arrp->pval = arr->pval;
             arrp->size = arr->size;
             arrp->index = arr->index;
@@ -660,13 +850,14 @@ static void set_extent(size_t* extent, psk Node)
         }
     }
 
-static Boolean set_vals(forthvalue* pval, size_t rank, size_t* extent, psk Node)
+static Boolean set_vals(fortharray* a, size_t offset, size_t rank, size_t* extent, psk Node)
     {
     assert(Op(Node) == COMMA);
     psk el;
     size_t stride = 1;
     size_t N;
     size_t index;
+    double val;
 
     for(size_t k = 0; k + 1 < rank; ++k)
         stride *= extent[k];
@@ -675,25 +866,29 @@ static Boolean set_vals(forthvalue* pval, size_t rank, size_t* extent, psk Node)
         {
         if(is_op(el->LEFT) && Op(el->LEFT) == COMMA)
             {
-            if(!set_vals(pval + index, rank - 1, extent, el->LEFT))
+            if(!set_vals(a, offset + index, rank - 1, extent, el->LEFT))
                 return FALSE;
             }
         else
             {
             for(size_t t = 0; t < stride; ++t)
-                if(!setFloat(&(pval[index + t].floating), el->LEFT))
+                if(!setFloat(&val, el->LEFT))
                     return FALSE;
+                else
+                    setElement(a, offset + index + t, val);
             }
         }
     if(is_op(el) && Op(el) == COMMA)
         {
-        return set_vals(pval + index, rank - 1, extent, el);
+        return set_vals(a, offset + index, rank - 1, extent, el);
         }
     else
         {
         for(size_t t = 0; t < stride; ++t)
-            if(!setFloat(&(pval[index + t].floating), el))
+            if(!setFloat(&val, el))
                 return FALSE;
+            else
+                setElement(a, offset + index + t, val);
         }
     return TRUE;
     }
@@ -722,6 +917,12 @@ static long setArgs(forthMemory* mem, size_t Nparm, psk args)
                 fortharray* a = 0;
                 if(curparm)
                     {
+                    if((size_t)ParmIndex >= mem->nparameters)
+                        {
+                        errorprintf("Too many arguments.\n");
+                        bfree(extent);
+                        return -1;
+                        }
                     a = curparm[ParmIndex].u.a;
                     if(a->size != totsize)
                         {
@@ -742,7 +943,7 @@ static long setArgs(forthMemory* mem, size_t Nparm, psk args)
                     a->extent = extent;
                     a->rank = rank;
                     */
-                    if(!set_vals(a->pval, rank, extent, args))
+                    if(!set_vals(a, 0, rank, extent, args))
                         {
                         errorprintf("Value is not numeric.\n");
                         bfree(extent);
@@ -765,6 +966,11 @@ static long setArgs(forthMemory* mem, size_t Nparm, psk args)
         forthvariable* var = 0;
         if(curparm)
             {
+            if((size_t)ParmIndex >= mem->nparameters)
+                {
+                errorprintf("Too many arguments.\n");
+                return -1;
+                }
             var = curparm[ParmIndex].u.v;
             if(!setFloat(&(var->val.floating), args))
                 return -1;
@@ -863,6 +1069,7 @@ static Etriple etriples[] =
         {"valDivide",valDivide,1},
         {"rand",  Drand,1},
         {"tbl",   Tbl,0},
+        {"ftbl",  Tbl,0},
         {"out",   Out,1},
         {"outln", Outln,1},
         {"idx",   Idx,0},
@@ -916,7 +1123,7 @@ static stackvalue* getArrayIndex(stackvalue* sp, forthword* wordp)
     /* else linear array passed as argument to calculation, a0, a1, ... */
     if(i >= arrp->size)
         {
-        errorprintf("%s: index %d is out of array bounds. (0 <= index < %zu)\n", arrp->name, (signed int)i, arrp->size);
+        runtimeError("%s: index %d is out of array bounds. (0 <= index < %zu)\n", arrp->name, (signed int)i, arrp->size);
         return 0;
         }
     arrp->index = i;
@@ -988,90 +1195,501 @@ static stackvalue* doTbl(stackvalue* sp, forthword* wordp, fortharray** parr)
             }
 
         arr = sp->arrp;
+        if(arr->mapping)
+            {
+            runtimeError("tbl: array \"%s\" is bound to a file.\n", arr->name);
+            return 0;
+            }
+        if(arr->exported)
+            {
+            runtimeError("tbl: array \"%s\" is in use outside Bracmat.\n", arr->name);
+            return 0;
+            }
         arr->size = size;
         arr->index = 0;
         assert(arr->pval == 0);
-        arr->pval = (forthvalue*)bmalloc(size * sizeof(forthvalue));
+        arr->pval = (forthvalue*)bmalloc(size * elementSize(arr));
         if(arr->pval)
             {
-            memset(arr->pval, 0, size * sizeof(forthvalue));
+            memset(arr->pval, 0, size * elementSize(arr));
             }
         arr->rank = rank;
         }
     return sp;
     }
 
+static unsigned int elementArity(actionType fun)
+/* 1 or 2 if map$ or zip$ can apply fun to the elements of arrays, otherwise 0 */
+    {
+    switch(fun)
+        {
+            case Acos: case Acosh: case Asin: case Asinh: case Atan: case Atanh:
+            case Cbrt: case Ceil: case Cos: case Cosh: case Exp: case Fabs:
+            case Floor: case Log: case Log10: case Sign: case Sin: case Sinh:
+            case Cube: case Sqr: case Sqrt: case Tan: case Tanh:
+                return 1;
+            case Plus: case Times: case Subtract: case Divide: case Atan2:
+            case Fdim: case Fmax: case Fmin: case Fmod: case Hypot: case Pow:
+                return 2;
+            default:
+                return 0;
+        }
+    }
+
+/* The loops below do not dispatch per element, so the compiler can keep them
+   tight and vectorize them where the operation allows it. */
+#define EACH(expr) for(i = 0; i < n; ++i) { double a = x[i]; d[i] = (expr); } break
+
+static void mapKernel(actionType fun, double* d, const double* x, size_t n)
+    {
+    size_t i;
+    switch(fun)
+        {
+            case Acos: EACH(acos(a));
+            case Acosh: EACH(acosh(a));
+            case Asin: EACH(asin(a));
+            case Asinh: EACH(asinh(a));
+            case Atan: EACH(atan(a));
+            case Atanh: EACH(atanh(a));
+            case Cbrt: EACH(cbrt(a));
+            case Ceil: EACH(ceil(a));
+            case Cos: EACH(cos(a));
+            case Cosh: EACH(cosh(a));
+            case Exp: EACH(exp(a));
+            case Fabs: EACH(fabs(a));
+            case Floor: EACH(floor(a));
+            case Log: EACH(log(a));
+            case Log10: EACH(log10(a));
+            case Sign: EACH(a > 0 ? 1.0 : a < 0 ? -1.0 : a);
+            case Sin: EACH(sin(a));
+            case Sinh: EACH(sinh(a));
+            case Cube: EACH(a * a * a);
+            case Sqr: EACH(a * a);
+            case Sqrt: EACH(sqrt(a));
+            case Tan: EACH(tan(a));
+            case Tanh: EACH(tanh(a));
+            default:
+                ;
+        }
+    }
+
+#undef EACH
+/* x or y is 0 if that operand is the number xs or ys instead of an array. */
+#define EACH(expr) \
+    if(x && y) for(i = 0; i < n; ++i) { double a = x[i]; double b = y[i]; d[i] = (expr); } \
+    else if(x) for(i = 0; i < n; ++i) { double a = x[i]; double b = ys; d[i] = (expr); } \
+    else for(i = 0; i < n; ++i) { double a = xs; double b = y[i]; d[i] = (expr); } \
+    break
+
+static void zipKernel(actionType fun, double* d, const double* x, double xs, const double* y, double ys, size_t n)
+    {
+    size_t i;
+    switch(fun)
+        {
+            case Plus: EACH(a + b);
+            case Times: EACH(a * b);
+            case Subtract: EACH(a - b);
+            case Divide: EACH(a / b);
+            case Atan2: EACH(atan2(a, b));
+            case Fdim: EACH(fdim(a, b));
+            case Fmax: EACH(fmax(a, b));
+            case Fmin: EACH(fmin(a, b));
+            case Fmod: EACH(fmod(a, b));
+            case Hypot: EACH(hypot(a, b));
+            case Pow: EACH(pow(a, b));
+            default:
+                ;
+        }
+    }
+
+#undef EACH
+
+static double reduceKernel(actionType fun, const double* x, size_t n)
+    {
+    size_t i;
+    double r;
+    switch(fun)
+        {
+            case Plus:
+                for(r = 0.0, i = 0; i < n; ++i)
+                    r += x[i];
+                return r;
+            case Times:
+                for(r = 1.0, i = 0; i < n; ++i)
+                    r *= x[i];
+                return r;
+            case Fmax:
+                for(r = x[0], i = 1; i < n; ++i)
+                    r = fmax(r, x[i]);
+                return r;
+            case Fmin:
+                for(r = x[0], i = 1; i < n; ++i)
+                    r = fmin(r, x[i]);
+                return r;
+            default:
+                return 0.0;
+        }
+    }
+
+static double dotKernel(const double* x, const double* y, size_t n)
+    {
+    size_t i;
+    double r = 0.0;
+    for(i = 0; i < n; ++i)
+        r += x[i] * y[i];
+    return r;
+    }
+
+static double runKernel(forthword* wordp, double** v, const double* s, size_t n)
+/* map$, zip$, reduce$ or dot$ on n elements of arrays of doubles. */
+    {
+    switch(wordp->action)
+        {
+            case Map:
+            case Zip:
+                {
+                if(v[1] || v[2])
+                    {
+                    if(wordp->action == Map)
+                        mapKernel(wordp->u.krnl.fun, v[0], v[1], n);
+                    else
+                        zipKernel(wordp->u.krnl.fun, v[0], v[1], s[1], v[2], s[2], n);
+                    }
+                else
+                    { /* Only numbers: compute once, then fill the array. */
+                    double c;
+                    size_t i;
+                    if(wordp->action == Map)
+                        mapKernel(wordp->u.krnl.fun, &c, s + 1, 1);
+                    else
+                        zipKernel(wordp->u.krnl.fun, &c, s + 1, 0.0, s + 2, 0.0, 1);
+                    for(i = 0; i < n; ++i)
+                        v[0][i] = c;
+                    }
+                return (double)n;
+                }
+            case Reduce:
+                return reduceKernel(wordp->u.krnl.fun, v[0], n);
+            default:
+                return dotKernel(v[0], v[1], n);
+        }
+    }
+
+#define STAGED 256 /* elements of 32-bit arrays that arrayKernel() converts at a time */
+
+/* A constant trip count lets the compiler vectorize full blocks. */
+static void widen(double* d, const float* f, size_t m)
+    {
+    size_t i;
+    if(m == STAGED)
+        for(i = 0; i < STAGED; ++i)
+            d[i] = (double)f[i];
+    else
+        for(i = 0; i < m; ++i)
+            d[i] = (double)f[i];
+    }
+
+static void narrow(float* f, const double* d, size_t m)
+    {
+    size_t i;
+    if(m == STAGED)
+        for(i = 0; i < STAGED; ++i)
+            f[i] = (float)d[i];
+    else
+        for(i = 0; i < m; ++i)
+            f[i] = (float)d[i];
+    }
+
+static stackvalue* arrayKernel(stackvalue* sp, forthword* wordp)
+/* 'runtime' function for map$, zip$, reduce$ and dot$. The operands are on the
+stack, arrays as pointers, numbers as values. All arrays must have the same
+size. Arrays of any rank are handled as the contiguous C arrays they are.
+Arrays of 32-bit elements are converted to doubles and back in blocks. */
+    {
+    unsigned int arity = wordp->offset;
+    stackvalue* args = sp - (arity - 1);
+    fortharray* first = 0;
+    fortharray* a[3] = { 0, 0, 0 };
+    double* v[3] = { 0, 0, 0 };
+    double s[3] = { 0.0, 0.0, 0.0 };
+    Boolean staged = FALSE;
+    size_t n = 0;
+    unsigned int k;
+    for(k = 0; k < arity; ++k)
+        {
+        if(wordp->u.krnl.scalars & (1u << k))
+            s[k] = args[k].val.floating;
+        else
+            {
+            fortharray* arr = args[k].arrp;
+            if(arr->pval == 0)
+                {
+                runtimeError("%s: array \"%s\" has no elements.\n", ActionAsWord[wordp->action], arr->name);
+                return 0;
+                }
+            if(first == 0)
+                {
+                first = arr;
+                n = arr->size;
+                }
+            else if(arr->size != n)
+                {
+                runtimeError("%s: array \"%s\" has %zu elements, array \"%s\" has %zu.\n", ActionAsWord[wordp->action], first->name, n, arr->name, arr->size);
+                return 0;
+                }
+            a[k] = arr;
+            v[k] = &(arr->pval->floating);
+            if(arr->type == Float32)
+                staged = TRUE;
+            }
+        }
+    if(!staged)
+        args->val.floating = runKernel(wordp, v, s, n);
+    else
+        {
+        double buf[3][STAGED];
+        double* bv[3] = { 0, 0, 0 };
+        double r = 0.0;
+        size_t done;
+        size_t m;
+        for(done = 0; done < n; done += m)
+            {
+            double part;
+            m = n - done < STAGED ? n - done : STAGED;
+            for(k = 0; k < arity; ++k)
+                {
+                if(a[k] == 0)
+                    continue;
+                if(a[k]->type == Float64)
+                    bv[k] = v[k] + done;
+                else
+                    {
+                    bv[k] = buf[k];
+                    widen(buf[k], (const float*)a[k]->pval + done, m);
+                    }
+                }
+            part = runKernel(wordp, bv, s, m);
+            if((wordp->action == Map || wordp->action == Zip) && a[0] && a[0]->type == Float32)
+                narrow((float*)a[0]->pval + done, buf[0], m);
+            if(done == 0)
+                r = part;
+            else if(wordp->action == Reduce)
+                {
+                double pair[2];
+                pair[0] = r;
+                pair[1] = part;
+                r = reduceKernel(wordp->u.krnl.fun, pair, 2);
+                }
+            else
+                r += part; /* Map and Zip count elements, Dot adds products. */
+            }
+        args->val.floating = r;
+        }
+    return args;
+    }
+
 static stackvalue* fcalculate(stackvalue* sp, forthword* wordp, double* ret);
 
+#if DIRECTTHREADING
+static THREADLOCAL void* const* handlerAddresses = 0;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
 static stackvalue* calculateBody(forthMemory* mem)
+/* With DIRECTTHREADING, each word jumps directly to the code for the next word.
+   Called with mem == 0, it only tells where that code is, see threadWords(). */
     {
+    double a;
+    double b;
+    size_t i;
+#if DIRECTTHREADING
+    static void* const handlers[] =
+        { &&L_TheEnd
+        , &&L_varPush
+        , &&L_var2stack
+        , &&L_var2stackBranch
+        , &&L_stack2var
+        , &&L_stack2varBranch
+        , &&L_ArrElmValPush
+        , &&L_stack2ArrElm
+        , &&L_val2stack
+        , &&L_valPush
+        , &&L_Afunction
+        , &&L_Pop
+        , &&L_Branch
+        , &&L_PopBranch
+        , &&L_valPushBranch
+        , &&L_val2stackBranch
+        , &&L_Fless
+        , &&L_Fless_equal
+        , &&L_Fmore_equal
+        , &&L_Fmore
+        , &&L_Funequal
+        , &&L_Fequal
+        , &&L_FlessP
+        , &&L_Fless_equalP
+        , &&L_Fmore_equalP
+        , &&L_FmoreP
+        , &&L_FunequalP
+        , &&L_FequalP
+        , &&L_Plus
+        , &&L_varPlus
+        , &&L_valPlus
+        , &&L_Times
+        , &&L_varTimes
+        , &&L_valTimes
+        , &&L_Acos
+        , &&L_Acosh
+        , &&L_Asin
+        , &&L_Asinh
+        , &&L_Atan
+        , &&L_Atanh
+        , &&L_Cbrt
+        , &&L_Ceil
+        , &&L_Cos
+        , &&L_Cosh
+        , &&L_Exp
+        , &&L_Fabs
+        , &&L_Floor
+        , &&L_Log
+        , &&L_Log10
+        , &&L_Sign
+        , &&L_Sin
+        , &&L_Sinh
+        , &&L_Cube
+        , &&L_Sqr
+        , &&L_Sqrt
+        , &&L_Tan
+        , &&L_Tanh
+        , &&L_Atan2
+        , &&L_Fdim
+        , &&L_Fmax
+        , &&L_Fmin
+        , &&L_Fmod
+        , &&L_Hypot
+        , &&L_Pow
+        , &&L_Subtract
+        , &&L_varSubtract
+        , &&L_valSubtract
+        , &&L_Divide
+        , &&L_varDivide
+        , &&L_valDivide
+        , &&L_Drand
+        , &&L_Tbl
+        , &&L_Out
+        , &&L_Outln
+        , &&L_Idx
+        , &&L_QIdx
+        , &&L_EIdx
+        , &&L_Extent
+        , &&L_Rank
+        , &&L_Map
+        , &&L_Zip
+        , &&L_Reduce
+        , &&L_Dot
+        , &&L_Eval
+        , &&L_rMove
+        , &&L_rPlus
+        , &&L_rTimes
+        , &&L_rSubtract
+        , &&L_rDivide
+        , &&L_rLess
+        , &&L_rLess_equal
+        , &&L_rMore_equal
+        , &&L_rMore
+        , &&L_rUnequal
+        , &&L_rEqual
+        , &&L_NoOp
+        , &&L_Profile /* PROFILEHANDLER */
+        };
+    assert(sizeof(handlers) / sizeof(handlers[0]) == PROFILEHANDLER + 1);
+    if(mem == 0)
+        {
+        handlerAddresses = handlers;
+        return 0;
+        }
+#endif
+#if JITCOMPILE
+    if(mem->jitcode && !mem->counts)
+        {
+        stackvalue* (*jitted)(stackvalue*);
+        memcpy(&jitted, &(mem->jitcode), sizeof(jitted));
+        return jitted(mem->sp - 1);
+        }
+#endif
     forthword* word = mem->word;
-    forthword* wordp = mem->wordp;
+    forthword* wordp = word;
     stackvalue* sp = mem->sp - 1;
-    for(wordp = word; wordp->action != TheEnd;)
+#if DIRECTTHREADING
+    NEXTWORD;
+        {
+            {
+#else
+    for(; wordp->action != TheEnd;)
         {
-        double a;
-        double b;
-        size_t i;
         assert(sp >= mem->sp - 1);
 #if CALCULATION_PROFILING
         ++wordp->count;
 #endif
+        if(mem->counts)
+            ++mem->counts[wordp - word];
         switch(wordp->action)
             {
-                case varPush:
+#endif
+                CALCWORD(varPush):
                     {
                     (++sp)->val = *(wordp++->u.valp);
-                    break;
+                    NEXTWORD;
                     }
-                case var2stack:
+                CALCWORD(var2stack):
                     {
                     sp->val = *(wordp++->u.valp);
-                    break;
+                    NEXTWORD;
                     }
-                case var2stackBranch:
+                CALCWORD(var2stackBranch):
                     {
                     sp->val = *(wordp->u.valp);
                     wordp = word + wordp->offset;
-                    break;
+                    NEXTWORD;
                     }
-                case stack2var:
+                CALCWORD(stack2var):
                     {
                     assert(sp >= mem->stack);
                     *(wordp++->u.valp) = sp->val;
-                    break;
+                    NEXTWORD;
                     }
-                case stack2varBranch:
+                CALCWORD(stack2varBranch):
                     {
                     assert(sp >= mem->stack);
                     *(wordp->u.valp) = sp->val;
                     wordp = word + wordp->offset;
-                    break;
+                    NEXTWORD;
                     }
-                case ArrElmValPush:
+                CALCWORD(ArrElmValPush):
                     {
-                    (++sp)->val = (wordp->u.arrp->pval)[wordp->u.arrp->index];
+                    (++sp)->val.floating = getElement(wordp->u.arrp, wordp->u.arrp->index);
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case stack2ArrElm:
+                CALCWORD(stack2ArrElm):
                     {
                     assert(sp >= mem->stack);
-                    (wordp->u.arrp->pval)[wordp->u.arrp->index] = sp->val;
+                    setElement(wordp->u.arrp, wordp->u.arrp->index, sp->val.floating);
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case val2stack:
+                CALCWORD(val2stack):
                     {
                     sp->val = wordp++->u.val;
-                    break;
+                    NEXTWORD;
                     }
-                case valPush:
+                CALCWORD(valPush):
                     {
                     (++sp)->val = wordp++->u.val;
-                    break;
+                    NEXTWORD;
                     }
-                case Afunction:
+                CALCWORD(Afunction):
                     {
                     double ret = 0;
                     stackvalue* res = fcalculate(sp, wordp, &ret);
@@ -1080,182 +1698,180 @@ static stackvalue* calculateBody(forthMemory* mem)
                     sp = res;
                     (++sp)->val.floating = ret;
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case Pop:
+                CALCWORD(Pop):
                     {
                     --sp;
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case Branch:
+                CALCWORD(Branch):
                     wordp = word + wordp->offset;
-                    break;
-                case PopBranch:
+                    NEXTWORD;
+                CALCWORD(PopBranch):
                     {
                     --sp;
                     wordp = word + wordp->offset;
-                    break;
+                    NEXTWORD;
                     }
-                case valPushBranch:
+                CALCWORD(valPushBranch):
                     {
                     (++sp)->val = wordp->u.val;
                     wordp = word + wordp->offset;
-                    break;
+                    NEXTWORD;
                     }
-                case val2stackBranch:
+                CALCWORD(val2stackBranch):
                     {
                     sp->val = wordp->u.val;
                     wordp = word + wordp->offset;
-                    break;
+                    NEXTWORD;
                     }
-                case Fless:
-                    b = ((sp--)->val).floating; if((sp->val).floating >= b) wordp = word + wordp->offset; else ++wordp; break;
-                case Fless_equal:
-                    b = ((sp--)->val).floating; if((sp->val).floating > b) wordp = word + wordp->offset; else ++wordp; break;
-                case Fmore_equal:
-                    b = ((sp--)->val).floating; if((sp->val).floating < b) wordp = word + wordp->offset; else ++wordp; break;
-                case Fmore:
-                    b = ((sp--)->val).floating; if((sp->val).floating <= b) wordp = word + wordp->offset; else ++wordp; break;
-                case Funequal:
-                    b = ((sp--)->val).floating; if((sp->val).floating == b) wordp = word + wordp->offset; else ++wordp; break;
-                case Fequal:
-                    b = ((sp--)->val).floating; if((sp->val).floating != b) wordp = word + wordp->offset; else ++wordp; break;
-                case FlessP:
-                    b = ((sp--)->val).floating; if(((sp--)->val).floating >= b) wordp = word + wordp->offset; else ++wordp; break;
-                case Fless_equalP:
-                    b = ((sp--)->val).floating; if(((sp--)->val).floating > b) wordp = word + wordp->offset; else ++wordp; break;
-                case Fmore_equalP:
-                    b = ((sp--)->val).floating; if(((sp--)->val).floating < b) wordp = word + wordp->offset; else ++wordp; break;
-                case FmoreP:
-                    b = ((sp--)->val).floating; if(((sp--)->val).floating <= b) wordp = word + wordp->offset; else ++wordp; break;
-                case FunequalP:
-                    b = ((sp--)->val).floating; if(((sp--)->val).floating == b) wordp = word + wordp->offset; else ++wordp; break;
-                case FequalP:
-                    b = ((sp--)->val).floating; if(((sp--)->val).floating != b) wordp = word + wordp->offset; else ++wordp; break;
-                case Plus:
-                    a = ((sp--)->val).floating; sp->val.floating += a; ++wordp; break;
-                case varPlus:
-                    sp->val.floating += wordp++->u.valp->floating; break;
-                case valPlus:
-                    sp->val.floating += wordp++->u.val.floating; break;
-                case Times:
-                    a = ((sp--)->val).floating; sp->val.floating *= a; ++wordp; break;
-                case varTimes:
-                    sp->val.floating *= wordp++->u.valp->floating; break;
-                case valTimes:
-                    sp->val.floating *= wordp++->u.val.floating; break;
-                case Acos:
-                    sp->val.floating = acos((sp->val).floating); ++wordp; break;
-                case Acosh:
-                    sp->val.floating = acosh((sp->val).floating); ++wordp; break;
-                case Asin:
-                    sp->val.floating = asin((sp->val).floating); ++wordp; break;
-                case Asinh:
-                    sp->val.floating = asinh((sp->val).floating); ++wordp; break;
-                case Atan:
-                    sp->val.floating = atan((sp->val).floating); ++wordp; break;
-                case Atanh:
-                    sp->val.floating = atanh((sp->val).floating); ++wordp; break;
-                case Cbrt:
-                    sp->val.floating = cbrt((sp->val).floating); ++wordp; break;
-                case Ceil:
-                    sp->val.floating = ceil((sp->val).floating); ++wordp; break;
-                case Cos:
-                    sp->val.floating = cos((sp->val).floating); ++wordp; break;
-                case Cosh:
-                    sp->val.floating = cosh((sp->val).floating); ++wordp; break;
-                case Exp:
-                    sp->val.floating = exp((sp->val).floating); ++wordp; break;
-                case Fabs:
-                    sp->val.floating = fabs((sp->val).floating); ++wordp; break;
-                case Floor:
-                    sp->val.floating = floor((sp->val).floating); ++wordp; break;
-                case Log:
-                    sp->val.floating = log((sp->val).floating); ++wordp; break;
-                case Log10:
-                    sp->val.floating = log10((sp->val).floating); ++wordp; break;
-                case Sign:
-                    b = (sp->val).floating; if(b != 0.0) { if(b > 0) sp->val.floating = 1.0; else if(b < 0) sp->val.floating = -1.0; } ++wordp; break;
-                case Sin:
-                    sp->val.floating = sin((sp->val).floating); ++wordp; break;
-                case Sinh:
-                    sp->val.floating = sinh((sp->val).floating); ++wordp; break;
-                case Cube:
-                    sp->val.floating *= sp->val.floating * sp->val.floating; ++wordp; break;
-                case Sqr:
-                    sp->val.floating *= sp->val.floating; ++wordp; break;
-                case Sqrt:
-                    sp->val.floating = sqrt((sp->val).floating); ++wordp; break;
-                case Tan:
-                    sp->val.floating = tan((sp->val).floating); ++wordp; break;
-                case Tanh:
-                    sp->val.floating = tanh((sp->val).floating); ++wordp; break;
-                case Atan2:
-                    a = ((sp--)->val).floating; sp->val.floating = atan2(a, (sp->val).floating); ++wordp; break;
-                case Fdim:
-                    a = ((sp--)->val).floating; sp->val.floating = fdim(a, (sp->val).floating); ++wordp; break;
-                case Fmax:
-                    a = ((sp--)->val).floating; sp->val.floating = fmax(a, (sp->val).floating); ++wordp; break;
-                case Fmin:
-                    a = ((sp--)->val).floating; sp->val.floating = fmin(a, (sp->val).floating); ++wordp; break;
-                case Fmod:
-                    a = ((sp--)->val).floating; sp->val.floating = fmod(a, (sp->val).floating); ++wordp; break;
-                case Hypot:
-                    a = ((sp--)->val).floating; sp->val.floating = hypot(a, (sp->val).floating); ++wordp; break;
-                case Pow:
-                    a = ((sp--)->val).floating; sp->val.floating = pow(a, (sp->val).floating); ++wordp; break;
-                case Subtract:
-                    a = ((sp--)->val).floating; sp->val.floating = (sp->val).floating - a; ++wordp; break;
-                case varSubtract:
-                    sp->val.floating -= wordp++->u.valp->floating; break;
-                case valSubtract:
-                    sp->val.floating -= wordp++->u.val.floating; break;
-                case Divide:
-                    a = ((sp--)->val).floating; sp->val.floating = (sp->val).floating / a; ++wordp; break;
-                case varDivide:
-                    sp->val.floating /= wordp++->u.valp->floating; break;
-                case valDivide:
-                    sp->val.floating /= wordp++->u.val.floating; break;
-                case Drand:
-                    sp->val.floating = drand((sp->val).floating); ++wordp; break;
-                case Tbl:
+                CALCWORD(Fless):
+                    b = ((sp--)->val).floating; if((sp->val).floating >= b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(Fless_equal):
+                    b = ((sp--)->val).floating; if((sp->val).floating > b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(Fmore_equal):
+                    b = ((sp--)->val).floating; if((sp->val).floating < b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(Fmore):
+                    b = ((sp--)->val).floating; if((sp->val).floating <= b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(Funequal):
+                    b = ((sp--)->val).floating; if((sp->val).floating == b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(Fequal):
+                    b = ((sp--)->val).floating; if((sp->val).floating != b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(FlessP):
+                    b = ((sp--)->val).floating; if(((sp--)->val).floating >= b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(Fless_equalP):
+                    b = ((sp--)->val).floating; if(((sp--)->val).floating > b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(Fmore_equalP):
+                    b = ((sp--)->val).floating; if(((sp--)->val).floating < b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(FmoreP):
+                    b = ((sp--)->val).floating; if(((sp--)->val).floating <= b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(FunequalP):
+                    b = ((sp--)->val).floating; if(((sp--)->val).floating == b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(FequalP):
+                    b = ((sp--)->val).floating; if(((sp--)->val).floating != b) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(Plus):
+                    a = ((sp--)->val).floating; sp->val.floating += a; ++wordp; NEXTWORD;
+                CALCWORD(varPlus):
+                    sp->val.floating += wordp++->u.valp->floating; NEXTWORD;
+                CALCWORD(valPlus):
+                    sp->val.floating += wordp++->u.val.floating; NEXTWORD;
+                CALCWORD(Times):
+                    a = ((sp--)->val).floating; sp->val.floating *= a; ++wordp; NEXTWORD;
+                CALCWORD(varTimes):
+                    sp->val.floating *= wordp++->u.valp->floating; NEXTWORD;
+                CALCWORD(valTimes):
+                    sp->val.floating *= wordp++->u.val.floating; NEXTWORD;
+                CALCWORD(Acos):
+                    sp->val.floating = acos((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Acosh):
+                    sp->val.floating = acosh((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Asin):
+                    sp->val.floating = asin((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Asinh):
+                    sp->val.floating = asinh((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Atan):
+                    sp->val.floating = atan((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Atanh):
+                    sp->val.floating = atanh((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Cbrt):
+                    sp->val.floating = cbrt((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Ceil):
+                    sp->val.floating = ceil((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Cos):
+                    sp->val.floating = cos((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Cosh):
+                    sp->val.floating = cosh((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Exp):
+                    sp->val.floating = exp((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Fabs):
+                    sp->val.floating = fabs((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Floor):
+                    sp->val.floating = floor((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Log):
+                    sp->val.floating = log((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Log10):
+                    sp->val.floating = log10((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Sign):
+                    b = (sp->val).floating; if(b != 0.0) { if(b > 0) sp->val.floating = 1.0; else if(b < 0) sp->val.floating = -1.0; } ++wordp; NEXTWORD;
+                CALCWORD(Sin):
+                    sp->val.floating = sin((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Sinh):
+                    sp->val.floating = sinh((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Cube):
+                    sp->val.floating *= sp->val.floating * sp->val.floating; ++wordp; NEXTWORD;
+                CALCWORD(Sqr):
+                    sp->val.floating *= sp->val.floating; ++wordp; NEXTWORD;
+                CALCWORD(Sqrt):
+                    sp->val.floating = sqrt((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Tan):
+                    sp->val.floating = tan((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Tanh):
+                    sp->val.floating = tanh((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Atan2):
+                    a = ((sp--)->val).floating; sp->val.floating = atan2(a, (sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Fdim):
+                    a = ((sp--)->val).floating; sp->val.floating = fdim(a, (sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Fmax):
+                    a = ((sp--)->val).floating; sp->val.floating = fmax(a, (sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Fmin):
+                    a = ((sp--)->val).floating; sp->val.floating = fmin(a, (sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Fmod):
+                    a = ((sp--)->val).floating; sp->val.floating = fmod(a, (sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Hypot):
+                    a = ((sp--)->val).floating; sp->val.floating = hypot(a, (sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Pow):
+                    a = ((sp--)->val).floating; sp->val.floating = pow(a, (sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Subtract):
+                    a = ((sp--)->val).floating; sp->val.floating = (sp->val).floating - a; ++wordp; NEXTWORD;
+                CALCWORD(varSubtract):
+                    sp->val.floating -= wordp++->u.valp->floating; NEXTWORD;
+                CALCWORD(valSubtract):
+                    sp->val.floating -= wordp++->u.val.floating; NEXTWORD;
+                CALCWORD(Divide):
+                    a = ((sp--)->val).floating; sp->val.floating = (sp->val).floating / a; ++wordp; NEXTWORD;
+                CALCWORD(varDivide):
+                    sp->val.floating /= wordp++->u.valp->floating; NEXTWORD;
+                CALCWORD(valDivide):
+                    sp->val.floating /= wordp++->u.val.floating; NEXTWORD;
+                CALCWORD(Drand):
+                    sp->val.floating = drand((sp->val).floating); ++wordp; NEXTWORD;
+                CALCWORD(Tbl):
                     {
                     sp = doTbl(sp, wordp, 0);
                     if(!sp)
                         return 0;
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case Out:
-                    printf("%f ", (sp--)->val.floating); ++wordp; break;
-                    break;
-                case Outln:
-                    printf("%f\n", (sp--)->val.floating); ++wordp; break;
-                    break;
-                case Idx:
+                CALCWORD(Out):
+                    printf("%f ", (sp--)->val.floating); ++wordp; NEXTWORD;
+                CALCWORD(Outln):
+                    printf("%f\n", (sp--)->val.floating); ++wordp; NEXTWORD;
+                CALCWORD(Idx):
                     {
                     if((sp = getArrayIndex(sp, wordp)) == 0)
                         return 0;
                     ++wordp;
                     --sp;
-                    break;
+                    NEXTWORD;
                     }
-                case QIdx:
+                CALCWORD(QIdx):
                     {
                     if((sp = getArrayIndex(sp, wordp)) == 0)
                         return 0;
                     i = sp->arrp->index;
 
-                    forthvalue* val = sp->arrp->pval + i;
+                    fortharray* arrp = sp->arrp;
 
                     assert(sp >= mem->stack);
                     assert(sp >= mem->stack);
-                    *val = (--sp)->val;
+                    setElement(arrp, i, (--sp)->val.floating);
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case EIdx:
+                CALCWORD(EIdx):
                     {
                     if((sp = getArrayIndex(sp, wordp)) == 0)
                         return 0;
@@ -1263,96 +1879,700 @@ static stackvalue* calculateBody(forthMemory* mem)
 
                     assert(sp >= mem->stack);
                     sp->arrp->index = i;
-                    sp->val = (sp->arrp->pval)[i];
+                    sp->val.floating = getElement(sp->arrp, i);
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case Extent:
+                CALCWORD(Extent):
                     {
                     sp = getArrayExtent(sp);
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case Rank:
+                CALCWORD(Rank):
                     {
                     sp = getArrayRank(sp);
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case Eval:
+                CALCWORD(Map):
+                CALCWORD(Zip):
+                CALCWORD(Reduce):
+                CALCWORD(Dot):
+                    {
+                    if((sp = arrayKernel(sp, wordp)) == 0)
+                        return 0;
+                    ++wordp;
+                    NEXTWORD;
+                    }
+                CALCWORD(Eval):
                     {
                     psk pnode;
                     pnode = eval(same_as_w(wordp->u.Pnode));
                     wipe(pnode);
                     ++wordp;
-                    break;
+                    NEXTWORD;
                     }
-                case NoOp:
+                CALCWORD(rMove):
+                    {
+                    regop* rop = wordp++->u.rop;
+                    *(rop->r) = *(rop->a);
+                    sp = rop->sp;
+                    NEXTWORD;
+                    }
+                CALCWORD(rPlus):
+                    {
+                    regop* rop = wordp++->u.rop;
+                    rop->r->floating = rop->a->floating + rop->b->floating;
+                    sp = rop->sp;
+                    NEXTWORD;
+                    }
+                CALCWORD(rTimes):
+                    {
+                    regop* rop = wordp++->u.rop;
+                    rop->r->floating = rop->a->floating * rop->b->floating;
+                    sp = rop->sp;
+                    NEXTWORD;
+                    }
+                CALCWORD(rSubtract):
+                    {
+                    regop* rop = wordp++->u.rop;
+                    rop->r->floating = rop->a->floating - rop->b->floating;
+                    sp = rop->sp;
+                    NEXTWORD;
+                    }
+                CALCWORD(rDivide):
+                    {
+                    regop* rop = wordp++->u.rop;
+                    rop->r->floating = rop->a->floating / rop->b->floating;
+                    sp = rop->sp;
+                    NEXTWORD;
+                    }
+                CALCWORD(rLess):
+                    sp = wordp->u.rop->sp; if(wordp->u.rop->a->floating >= wordp->u.rop->b->floating) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(rLess_equal):
+                    sp = wordp->u.rop->sp; if(wordp->u.rop->a->floating > wordp->u.rop->b->floating) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(rMore_equal):
+                    sp = wordp->u.rop->sp; if(wordp->u.rop->a->floating < wordp->u.rop->b->floating) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(rMore):
+                    sp = wordp->u.rop->sp; if(wordp->u.rop->a->floating <= wordp->u.rop->b->floating) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(rUnequal):
+                    sp = wordp->u.rop->sp; if(wordp->u.rop->a->floating == wordp->u.rop->b->floating) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(rEqual):
+                    sp = wordp->u.rop->sp; if(wordp->u.rop->a->floating != wordp->u.rop->b->floating) wordp = word + wordp->offset; else ++wordp; NEXTWORD;
+                CALCWORD(NoOp):
                     ++wordp;
-                    break;
+                    NEXTWORD;
+#if DIRECTTHREADING
+                L_Profile: /* all words while profiling, see profileWords() */
+                    ++mem->counts[wordp - word];
+                    goto *handlers[wordp->action];
+                L_TheEnd:
+                    return sp;
+#else
                 case TheEnd:
                 default:
                     break;
+#endif
             }
         }
+#if !DIRECTTHREADING
+    if(mem->counts)
+        ++mem->counts[wordp - word];
+#endif
     return sp;
     }
 
-static Boolean calculate(struct typedObjectnode* This, ppsk arg)
+#if DIRECTTHREADING
+#pragma GCC diagnostic pop
+
+static void threadWords(forthword* wordp)
+/* Let each word point to the code that performs its action. */
     {
-    psk Arg = (*arg)->RIGHT;
-    forthMemory* mem = (forthMemory*)(This->voiddata);
-    if(mem)
+    if(handlerAddresses == 0)
+        calculateBody(0);
+    for(;; ++wordp)
         {
-        parameter* curparm = mem->parameters;
-        if(!curparm || setArgs(mem, 0, Arg) > 0)
-            {
-            stackvalue* sp = calculateBody(mem);
-            if(sp)
+        wordp->handler = handlerAddresses[wordp->action];
+        if(wordp->action == TheEnd)
+            break;
+        }
+    }
+#endif
+
+#if JITCOMPILE
+/* The JIT compiler translates each word to a fixed sequence of x86-64
+instructions. rbx holds the stack pointer sp. Numbers pass through xmm0 and
+xmm1. Math functions are called directly. Words that do more, such as idx$ or
+calling a user defined function, call jitHelper(). If anything goes wrong while
+compiling, calculateBody() interprets the words, as before. */
+
+#define JITMAXWORDSIZE 64 /* bytes of machine code per word, at most */
+
+static double jitSign(double b)
+    {
+    if(b != 0.0)
+        {
+        if(b > 0)
+            return 1.0;
+        else if(b < 0)
+            return -1.0;
+        }
+    return b;
+    }
+
+static stackvalue* jitHelper(stackvalue* sp, forthword* wordp)
+/* Same as in calculateBody(). Returns 0 if an error occurred. */
+    {
+    switch(wordp->action)
+        {
+            case Afunction:
                 {
-                for(; sp >= mem->stack;)
+                double ret = 0;
+                stackvalue* res = fcalculate(sp, wordp, &ret);
+                if(!res)
+                    return 0;
+                sp = res;
+                (++sp)->val.floating = ret;
+                return sp;
+                }
+            case Tbl:
+                return doTbl(sp, wordp, 0);
+            case Out:
+                printf("%f ", (sp--)->val.floating);
+                return sp;
+            case Outln:
+                printf("%f\n", (sp--)->val.floating);
+                return sp;
+            case Idx:
+                if((sp = getArrayIndex(sp, wordp)) == 0)
+                    return 0;
+                return --sp;
+            case QIdx:
+                {
+                if((sp = getArrayIndex(sp, wordp)) == 0)
+                    return 0;
+                fortharray* arrp = sp->arrp;
+                setElement(arrp, arrp->index, (--sp)->val.floating);
+                return sp;
+                }
+            case EIdx:
+                if((sp = getArrayIndex(sp, wordp)) == 0)
+                    return 0;
+                sp->val.floating = getElement(sp->arrp, sp->arrp->index);
+                return sp;
+            case Extent:
+                return getArrayExtent(sp);
+            case Rank:
+                return getArrayRank(sp);
+            case Map:
+            case Zip:
+            case Reduce:
+            case Dot:
+                return arrayKernel(sp, wordp);
+            case Eval:
+                wipe(eval(same_as_w(wordp->u.Pnode)));
+                return sp;
+            default:
+                return 0;
+        }
+    }
+
+static double(*jitUnary(actionType action))(double)
+    {
+    switch(action)
+        {
+            case Acos: return acos;
+            case Acosh: return acosh;
+            case Asin: return asin;
+            case Asinh: return asinh;
+            case Atan: return atan;
+            case Atanh: return atanh;
+            case Cbrt: return cbrt;
+            case Ceil: return ceil;
+            case Cos: return cos;
+            case Cosh: return cosh;
+            case Exp: return exp;
+            case Fabs: return fabs;
+            case Floor: return floor;
+            case Log: return log;
+            case Log10: return log10;
+            case Sign: return jitSign;
+            case Sin: return sin;
+            case Sinh: return sinh;
+            case Tan: return tan;
+            case Tanh: return tanh;
+            case Drand: return drand;
+            default: return 0;
+        }
+    }
+
+static double(*jitBinary(actionType action))(double, double)
+    {
+    switch(action)
+        {
+            case Atan2: return atan2;
+            case Fdim: return fdim;
+            case Fmax: return fmax;
+            case Fmin: return fmin;
+            case Fmod: return fmod;
+            case Hypot: return hypot;
+            case Pow: return pow;
+            default: return 0;
+        }
+    }
+
+static unsigned char* emit(unsigned char* p, const char* bytes, size_t n)
+    {
+    memcpy(p, bytes, n);
+    return p + n;
+    }
+
+static unsigned char* emitImm64(unsigned char* p, const char* opcode, const void* imm)
+/* mov rax/rsi, imm64 */
+    {
+    p = emit(p, opcode, 2);
+    memcpy(p, imm, 8);
+    return p + 8;
+    }
+
+#define MOVRAX(p, imm) emitImm64(p, "\x48\xB8", imm)
+#define MOVRSI(p, imm) emitImm64(p, "\x48\xBE", imm)
+
+typedef struct jitfixup
+    {
+    size_t at; /* position of rel32 */
+    unsigned int target; /* index of word, or UINT_MAX for error exit */
+    } jitfixup;
+
+static unsigned char* jump(unsigned char* p, const char* opcode, size_t n, unsigned char* code, jitfixup** fixup, unsigned int target)
+    {
+    p = emit(p, opcode, n);
+    (*fixup)->at = (size_t)(p - code);
+    (*fixup)->target = target;
+    ++*fixup;
+    return emit(p, "\0\0\0\0", 4);
+    }
+
+static unsigned char* jitCompare(unsigned char* p, actionType cmp, unsigned char* code, jitfixup** fixup, unsigned int target)
+/* Jump to target like the stack word cmp, comparing xmm0 (below the top) with
+   xmm1 (the top). */
+    {
+    switch(cmp)
+        {
+            case Fless: /* jump if xmm0 >= xmm1 */
+                p = emit(p, "\x66\x0F\x2E\xC1", 4);
+                p = jump(p, "\x0F\x83", 2, code, fixup, target);
+                break;
+            case Fless_equal: /* jump if xmm0 > xmm1 */
+                p = emit(p, "\x66\x0F\x2E\xC1", 4);
+                p = jump(p, "\x0F\x87", 2, code, fixup, target);
+                break;
+            case Fmore_equal: /* jump if xmm1 > xmm0 */
+                p = emit(p, "\x66\x0F\x2E\xC8", 4);
+                p = jump(p, "\x0F\x87", 2, code, fixup, target);
+                break;
+            case Fmore: /* jump if xmm1 >= xmm0 */
+                p = emit(p, "\x66\x0F\x2E\xC8", 4);
+                p = jump(p, "\x0F\x83", 2, code, fixup, target);
+                break;
+            case Funequal: /* jump if equal and not unordered */
+                p = emit(p, "\x66\x0F\x2E\xC1", 4);
+                p = emit(p, "\x7A\x06", 2); /* jp over the je */
+                p = jump(p, "\x0F\x84", 2, code, fixup, target);
+                break;
+            default: /* Fequal: jump if unequal or unordered */
+                p = emit(p, "\x66\x0F\x2E\xC1", 4);
+                p = jump(p, "\x0F\x8A", 2, code, fixup, target);
+                p = jump(p, "\x0F\x85", 2, code, fixup, target);
+        }
+    return p;
+    }
+
+static Boolean jitCompile(forthMemory* mem)
+    {
+    forthword* word = mem->word;
+    forthword* wordp;
+    size_t nwords;
+    size_t size;
+    size_t* start;
+    jitfixup* fixups;
+    jitfixup* fixup;
+    unsigned char* code;
+    unsigned char* p;
+    unsigned char* entry;
+    Boolean ok = TRUE;
+    for(nwords = 1; word[nwords - 1].action != TheEnd; ++nwords)
+        ;
+    size = 16 + nwords * JITMAXWORDSIZE;
+    code = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(code == MAP_FAILED)
+        return FALSE;
+    start = (size_t*)bmalloc(nwords * sizeof(size_t));
+    fixups = (jitfixup*)bmalloc(2 * nwords * sizeof(jitfixup) + 1);
+    if(!start || !fixups)
+        {
+        if(start)
+            bfree(start);
+        if(fixups)
+            bfree(fixups);
+        munmap(code, size);
+        return FALSE;
+        }
+    fixup = fixups;
+    p = code;
+    p = emit(p, "\x31\xC0\x5B\xC3", 4);          /* error exit: xor eax,eax; pop rbx; ret */
+    entry = p;
+    p = emit(p, "\x53\x48\x89\xFB", 4);          /* push rbx; mov rbx,rdi */
+    for(wordp = word; ok; ++wordp)
+        {
+        double(*unary)(double);
+        double(*binary)(double, double);
+        start[wordp - word] = (size_t)(p - code);
+        switch(wordp->action)
+            {
+                case TheEnd:
+                    p = emit(p, "\x48\x89\xD8\x5B\xC3", 5); /* mov rax,rbx; pop rbx; ret */
+                    break;
+                case varPush:
+                case var2stack:
+                case var2stackBranch:
+                    p = MOVRAX(p, &(wordp->u.valp));
+                    p = emit(p, "\xF2\x0F\x10\x00", 4);  /* movsd xmm0,[rax] */
+                    if(wordp->action == varPush)
+                        p = emit(p, "\x48\x83\xC3\x08", 4); /* add rbx,8 */
+                    p = emit(p, "\xF2\x0F\x11\x03", 4);  /* movsd [rbx],xmm0 */
+                    if(wordp->action == var2stackBranch)
+                        p = jump(p, "\xE9", 1, code, &fixup, wordp->offset);
+                    break;
+                case stack2var:
+                case stack2varBranch:
+                    p = emit(p, "\xF2\x0F\x10\x03", 4);  /* movsd xmm0,[rbx] */
+                    p = MOVRAX(p, &(wordp->u.valp));
+                    p = emit(p, "\xF2\x0F\x11\x00", 4);  /* movsd [rax],xmm0 */
+                    if(wordp->action == stack2varBranch)
+                        p = jump(p, "\xE9", 1, code, &fixup, wordp->offset);
+                    break;
+                case ArrElmValPush:
+                case stack2ArrElm:
                     {
-                    psk res;
-                    size_t len;
-                    char buf[64]; /* 64 bytes is even enough for quad https://people.eecs.berkeley.edu/~wkahan/ieee754status/IEEE754.PDF*/
-                    double sv = (sp--)->val.floating;
-                    int flags;
-                    if(isnan(sv))
+                    char disp[4] = { '\x48', '\x8B', '\x48', (char)offsetof(fortharray, pval) };
+                    p = MOVRAX(p, &(wordp->u.arrp));
+                    p = emit(p, disp, 4);                   /* mov rcx,[rax+pval] */
+                    disp[2] = '\x50';
+                    disp[3] = (char)offsetof(fortharray, index);
+                    p = emit(p, disp, 4);                   /* mov rdx,[rax+index] */
+                    if(wordp->u.arrp->type == Float32)
                         {
-                        strcpy(buf, "NAN");
-                        flags = READY BITWISE_OR_SELFMATCHING;
+                        if(wordp->action == ArrElmValPush)
+                            {
+                            p = emit(p, "\xF3\x0F\x5A\x04\x91", 5); /* cvtss2sd xmm0,[rcx+rdx*4] */
+                            p = emit(p, "\x48\x83\xC3\x08", 4);     /* add rbx,8 */
+                            p = emit(p, "\xF2\x0F\x11\x03", 4);     /* movsd [rbx],xmm0 */
+                            }
+                        else
+                            {
+                            p = emit(p, "\xF2\x0F\x5A\x03", 4);     /* cvtsd2ss xmm0,[rbx] */
+                            p = emit(p, "\xF3\x0F\x11\x04\x91", 5); /* movss [rcx+rdx*4],xmm0 */
+                            }
                         }
-                    else if(isinf(sv))
+                    else if(wordp->action == ArrElmValPush)
                         {
-                        if(sv > DBL_MAX)
-                            strcpy(buf, "INF");
-                        else
-                            strcpy(buf, "-INF");
-                        flags = READY BITWISE_OR_SELFMATCHING;
+                        p = emit(p, "\xF2\x0F\x10\x04\xD1", 5); /* movsd xmm0,[rcx+rdx*8] */
+                        p = emit(p, "\x48\x83\xC3\x08", 4);     /* add rbx,8 */
+                        p = emit(p, "\xF2\x0F\x11\x03", 4);     /* movsd [rbx],xmm0 */
                         }
                     else
                         {
-                        sprintf(buf, "%.16E", sv);
-                        flags = READY | SUCCESS | QNUMBER | QDOUBLE BITWISE_OR_SELFMATCHING;
+                        p = emit(p, "\xF2\x0F\x10\x03", 4);     /* movsd xmm0,[rbx] */
+                        p = emit(p, "\xF2\x0F\x11\x04\xD1", 5); /* movsd [rcx+rdx*8],xmm0 */
                         }
-                    len = offsetof(sk, u.obj) + strlen(buf);
-                    res = (psk)bmalloc(len + 1);
-
-                    if(res)
+                    break;
+                    }
+                case valPush:
+                case val2stack:
+                case valPushBranch:
+                case val2stackBranch:
+                    if(wordp->action == valPush || wordp->action == valPushBranch)
+                        p = emit(p, "\x48\x83\xC3\x08", 4);  /* add rbx,8 */
+                    p = MOVRAX(p, &(wordp->u.val));
+                    p = emit(p, "\x48\x89\x03", 3);           /* mov [rbx],rax */
+                    if(wordp->action == valPushBranch || wordp->action == val2stackBranch)
+                        p = jump(p, "\xE9", 1, code, &fixup, wordp->offset);
+                    break;
+                case Pop:
+                    p = emit(p, "\x48\x83\xEB\x08", 4);      /* sub rbx,8 */
+                    break;
+                case Branch:
+                    p = jump(p, "\xE9", 1, code, &fixup, wordp->offset);
+                    break;
+                case PopBranch:
+                    p = emit(p, "\x48\x83\xEB\x08", 4);
+                    p = jump(p, "\xE9", 1, code, &fixup, wordp->offset);
+                    break;
+                case Fless:
+                case Fless_equal:
+                case Fmore_equal:
+                case Fmore:
+                case Funequal:
+                case Fequal:
+                case FlessP:
+                case Fless_equalP:
+                case Fmore_equalP:
+                case FmoreP:
+                case FunequalP:
+                case FequalP:
+                    {
+                    /* xmm0 = the value below the top, xmm1 = the top */
+                    Boolean popTwice = wordp->action >= FlessP;
+                    actionType cmp = popTwice ? (actionType)(wordp->action - FlessP + Fless) : wordp->action;
+                    p = emit(p, "\xF2\x0F\x10\x0B", 4);      /* movsd xmm1,[rbx] */
+                    p = emit(p, "\xF2\x0F\x10\x43\xF8", 5);  /* movsd xmm0,[rbx-8] */
+                    p = emit(p, popTwice ? "\x48\x83\xEB\x10" : "\x48\x83\xEB\x08", 4); /* sub rbx,16 or 8 */
+                    p = jitCompare(p, cmp, code, &fixup, wordp->offset);
+                    break;
+                    }
+                case Plus:
+                case Times:
+                case Subtract:
+                case Divide:
+                    {
+                    char op[4] = { '\xF2', '\x0F', 0, '\xC1' };
+                    op[2] = wordp->action == Plus ? '\x58' : wordp->action == Times ? '\x59' : wordp->action == Subtract ? '\x5C' : '\x5E';
+                    p = emit(p, "\xF2\x0F\x10\x43\xF8", 5);  /* movsd xmm0,[rbx-8] */
+                    p = emit(p, "\xF2\x0F\x10\x0B", 4);      /* movsd xmm1,[rbx] */
+                    p = emit(p, op, 4);                         /* addsd/mulsd/subsd/divsd xmm0,xmm1 */
+                    p = emit(p, "\x48\x83\xEB\x08", 4);      /* sub rbx,8 */
+                    p = emit(p, "\xF2\x0F\x11\x03", 4);      /* movsd [rbx],xmm0 */
+                    break;
+                    }
+                case varPlus:
+                case varTimes:
+                case varSubtract:
+                case varDivide:
+                case valPlus:
+                case valTimes:
+                case valSubtract:
+                case valDivide:
+                    {
+                    char op[4] = { '\xF2', '\x0F', 0, '\xC1' };
+                    switch(wordp->action)
                         {
-                        strcpy((char*)(res)+offsetof(sk, u.sobj), buf);
-                        wipe(*arg);
-                        *arg = res;
-                        res->v.fl = flags;
-                        return TRUE;
+                            case varPlus: case valPlus: op[2] = '\x58'; break;
+                            case varTimes: case valTimes: op[2] = '\x59'; break;
+                            case varSubtract: case valSubtract: op[2] = '\x5C'; break;
+                            default: op[2] = '\x5E';
+                        }
+                    p = emit(p, "\xF2\x0F\x10\x03", 4);      /* movsd xmm0,[rbx] */
+                    if(wordp->action == varPlus || wordp->action == varTimes || wordp->action == varSubtract || wordp->action == varDivide)
+                        {
+                        p = MOVRAX(p, &(wordp->u.valp));
+                        p = emit(p, "\xF2\x0F\x10\x08", 4);  /* movsd xmm1,[rax] */
                         }
+                    else
+                        {
+                        p = MOVRAX(p, &(wordp->u.val));
+                        p = emit(p, "\x66\x48\x0F\x6E\xC8", 5); /* movq xmm1,rax */
+                        }
+                    p = emit(p, op, 4);
+                    p = emit(p, "\xF2\x0F\x11\x03", 4);      /* movsd [rbx],xmm0 */
+                    break;
                     }
-                }
-            else
-                return FALSE;
+                case Cube:
+                    p = emit(p, "\xF2\x0F\x10\x03", 4);      /* movsd xmm0,[rbx] */
+                    p = emit(p, "\x66\x0F\x28\xC8", 4);      /* movapd xmm1,xmm0 */
+                    p = emit(p, "\xF2\x0F\x59\xC8", 4);      /* mulsd xmm1,xmm0 */
+                    p = emit(p, "\xF2\x0F\x59\xC1", 4);      /* mulsd xmm0,xmm1 */
+                    p = emit(p, "\xF2\x0F\x11\x03", 4);      /* movsd [rbx],xmm0 */
+                    break;
+                case Sqr:
+                    p = emit(p, "\xF2\x0F\x10\x03", 4);
+                    p = emit(p, "\xF2\x0F\x59\xC0", 4);      /* mulsd xmm0,xmm0 */
+                    p = emit(p, "\xF2\x0F\x11\x03", 4);
+                    break;
+                case Sqrt:
+                    p = emit(p, "\xF2\x0F\x10\x03", 4);
+                    p = emit(p, "\xF2\x0F\x51\xC0", 4);      /* sqrtsd xmm0,xmm0 */
+                    p = emit(p, "\xF2\x0F\x11\x03", 4);
+                    break;
+                case rMove:
+                    {
+                    regop* rop = wordp->u.rop;
+                    p = MOVRAX(p, &(rop->a));
+                    p = emit(p, "\x48\x8B\x00", 3);          /* mov rax,[rax] */
+                    p = MOVRSI(p, &(rop->r));
+                    p = emit(p, "\x48\x89\x06", 3);          /* mov [rsi],rax */
+                    p = emitImm64(p, "\x48\xBB", &(rop->sp)); /* mov rbx,sp */
+                    break;
+                    }
+                case rPlus:
+                case rTimes:
+                case rSubtract:
+                case rDivide:
+                    {
+                    regop* rop = wordp->u.rop;
+                    char op[4] = { '\xF2', '\x0F', 0, '\xC1' };
+                    op[2] = "\x58\x59\x5C\x5E"[wordp->action - rPlus];
+                    p = MOVRAX(p, &(rop->a));
+                    p = emit(p, "\xF2\x0F\x10\x00", 4);      /* movsd xmm0,[rax] */
+                    p = MOVRAX(p, &(rop->b));
+                    p = emit(p, "\xF2\x0F\x10\x08", 4);      /* movsd xmm1,[rax] */
+                    p = emit(p, op, 4);
+                    p = MOVRAX(p, &(rop->r));
+                    p = emit(p, "\xF2\x0F\x11\x00", 4);      /* movsd [rax],xmm0 */
+                    p = emitImm64(p, "\x48\xBB", &(rop->sp)); /* mov rbx,sp */
+                    break;
+                    }
+                case rLess:
+                case rLess_equal:
+                case rMore_equal:
+                case rMore:
+                case rUnequal:
+                case rEqual:
+                    {
+                    regop* rop = wordp->u.rop;
+                    p = MOVRAX(p, &(rop->a));
+                    p = emit(p, "\xF2\x0F\x10\x00", 4);      /* movsd xmm0,[rax] */
+                    p = MOVRAX(p, &(rop->b));
+                    p = emit(p, "\xF2\x0F\x10\x08", 4);      /* movsd xmm1,[rax] */
+                    p = emitImm64(p, "\x48\xBB", &(rop->sp)); /* mov rbx,sp */
+                    p = jitCompare(p, (actionType)(wordp->action - rLess + Fless), code, &fixup, wordp->offset);
+                    break;
+                    }
+                case NoOp:
+                    break;
+                default:
+                    if((unary = jitUnary(wordp->action)) != 0)
+                        {
+                        p = emit(p, "\xF2\x0F\x10\x03", 4);  /* movsd xmm0,[rbx] */
+                        p = MOVRAX(p, &unary);
+                        p = emit(p, "\xFF\xD0", 2);            /* call rax */
+                        p = emit(p, "\xF2\x0F\x11\x03", 4);  /* movsd [rbx],xmm0 */
+                        }
+                    else if((binary = jitBinary(wordp->action)) != 0)
+                        { /* a = top, sp->val = f(a, sp->val) */
+                        p = emit(p, "\xF2\x0F\x10\x03", 4);      /* movsd xmm0,[rbx] */
+                        p = emit(p, "\xF2\x0F\x10\x4B\xF8", 5);  /* movsd xmm1,[rbx-8] */
+                        p = emit(p, "\x48\x83\xEB\x08", 4);      /* sub rbx,8 */
+                        p = MOVRAX(p, &binary);
+                        p = emit(p, "\xFF\xD0", 2);
+                        p = emit(p, "\xF2\x0F\x11\x03", 4);
+                        }
+                    else
+                        {
+                        stackvalue* (*helper)(stackvalue*, forthword*) = jitHelper;
+                        p = emit(p, "\x48\x89\xDF", 3);           /* mov rdi,rbx */
+                        p = MOVRSI(p, &wordp);
+                        p = MOVRAX(p, &helper);
+                        p = emit(p, "\xFF\xD0", 2);                /* call rax */
+                        p = emit(p, "\x48\x85\xC0", 3);           /* test rax,rax */
+                        p = jump(p, "\x0F\x84", 2, code, &fixup, UINT_MAX); /* jz error exit */
+                        p = emit(p, "\x48\x89\xC3", 3);           /* mov rbx,rax */
+                        }
             }
+        assert((size_t)(p - code) - start[wordp - word] <= JITMAXWORDSIZE);
+        if(wordp->action == TheEnd)
+            break;
+        }
+    for(jitfixup* f = fixups; f < fixup; ++f)
+        {
+        size_t target = f->target == UINT_MAX ? 0 : start[f->target];
+        int32_t rel = (int32_t)((LONG)target - (LONG)(f->at + 4));
+        memcpy(code + f->at, &rel, 4);
+        }
+    bfree(start);
+    bfree(fixups);
+    if(mprotect(code, size, PROT_READ | PROT_EXEC) != 0)
+        {
+        munmap(code, size);
+        return FALSE;
+        }
+    mem->jitcode = entry;
+    mem->jitsize = size;
+    return TRUE;
+    }
+
+static void jitFree(forthMemory* mem)
+    {
+    if(mem->jitcode)
+        {
+        munmap(mem->jitcode - 4, mem->jitsize); /* 4: the error exit comes first */
+        mem->jitcode = 0;
+        }
+    }
+#endif
+
+static stackvalue* runBody(forthMemory* mem)
+/* calculateBody(), timed while profiling. */
+    {
+    stackvalue* sp;
+    if(mem->counts)
+        {
+        clock_t t0 = clock();
+        sp = calculateBody(mem);
+        mem->ticks += clock() - t0;
+        ++mem->calls;
+        }
+    else
+        sp = calculateBody(mem);
+    return sp;
+    }
+
+static psk calcResult(double sv)
+    {
+    psk res;
+    size_t len;
+    char buf[64]; /* 64 bytes is even enough for quad https://people.eecs.berkeley.edu/~wkahan/ieee754status/IEEE754.PDF*/
+    int flags;
+    if(isnan(sv))
+        {
+        strcpy(buf, "NAN");
+        flags = READY BITWISE_OR_SELFMATCHING;
+        }
+    else if(isinf(sv))
+        {
+        if(sv > DBL_MAX)
+            strcpy(buf, "INF");
         else
-            return FALSE;
+            strcpy(buf, "-INF");
+        flags = READY BITWISE_OR_SELFMATCHING;
+        }
+    else
+        {
+        sprintf(buf, "%.16E", sv);
+        flags = READY | SUCCESS | QNUMBER | QDOUBLE BITWISE_OR_SELFMATCHING;
+        }
+    len = offsetof(sk, u.obj) + strlen(buf);
+    res = (psk)bmalloc(len + 1);
+    if(res)
+        {
+        strcpy((char*)(res)+offsetof(sk, u.sobj), buf);
+        res->v.fl = flags;
+        }
+    return res;
+    }
+
+static Boolean calculate(struct typedObjectnode* This, ppsk arg)
+    {
+    psk Arg = (*arg)->RIGHT;
+    forthMemory* mem = (forthMemory*)(This->voiddata);
+    if(mem)
+        {
+        parameter* curparm = mem->parameters;
+        if(!curparm || setArgs(mem, 0, Arg) > 0)
+            {
+            stackvalue* sp = runBody(mem);
+            if(sp && sp >= mem->stack)
+                {
+                psk res = calcResult(sp->val.floating);
+                if(res)
+                    {
+                    wipe(*arg);
+                    *arg = res;
+                    return TRUE;
+                    }
+                }
+            }
         }
     return FALSE;
     }
@@ -1364,7 +2584,9 @@ static stackvalue* fcalculate(stackvalue* sp, forthword* wordp, double* ret)
         {
         stackvalue* sp2;
         sp = fsetArgs(sp, wordp->offset, thatmem);
-        sp2 = calculateBody(thatmem);
+        if(!sp)
+            return 0;
+        sp2 = runBody(thatmem);
         if(sp2 && sp2 >= thatmem->stack)
             {
             *ret = thatmem->stack->val.floating;
@@ -1429,16 +2651,16 @@ static stackvalue* trcBody(forthMemory* mem)
                     }
                 case ArrElmValPush:
                     {
-                    printf("%s %.2f --> stack", wordp->u.arrp->name, (wordp->u.arrp->pval)[wordp->u.arrp->index].floating);
-                    (++sp)->val = (wordp->u.arrp->pval)[wordp->u.arrp->index];
+                    printf("%s %.2f --> stack", wordp->u.arrp->name, getElement(wordp->u.arrp, wordp->u.arrp->index));
+                    (++sp)->val.floating = getElement(wordp->u.arrp, wordp->u.arrp->index);
                     ++wordp;
                     break;
                     }
                 case stack2ArrElm:
                     {
                     assert(sp >= mem->stack);
-                    (wordp->u.arrp->pval)[wordp->u.arrp->index] = sp->val;
-                    printf("%s %.2f <-- stack", wordp->u.arrp->name, (wordp->u.arrp->pval)[wordp->u.arrp->index].floating);
+                    setElement(wordp->u.arrp, wordp->u.arrp->index, sp->val.floating);
+                    printf("%s %.2f <-- stack", wordp->u.arrp->name, getElement(wordp->u.arrp, wordp->u.arrp->index));
                     ++wordp;
                     break;
                     }
@@ -1704,12 +2926,12 @@ static stackvalue* trcBody(forthMemory* mem)
                         return 0;
                     i = sp->arrp->index;
 
-                    forthvalue* val = sp->arrp->pval + i;
+                    fortharray* arrp = sp->arrp;
 
                     printf("PopPop ?index  ");
                     assert(sp >= mem->stack);
                     assert(sp >= mem->stack);
-                    *val = (--sp)->val;
+                    setElement(arrp, i, (--sp)->val.floating);
                     ++wordp;
                     break;
                     }
@@ -1722,7 +2944,7 @@ static stackvalue* trcBody(forthMemory* mem)
                     printf("Pop !index  ");
                     assert(sp >= mem->stack);
                     sp->arrp->index = i;
-                    sp->val = (sp->arrp->pval)[i];
+                    sp->val.floating = getElement(sp->arrp, i);
                     ++wordp;
                     break;
                     }
@@ -1742,6 +2964,18 @@ static stackvalue* trcBody(forthMemory* mem)
                     ++wordp;
                     break;
                     }
+                case Map:
+                case Zip:
+                case Reduce:
+                case Dot:
+                    {
+                    printf("%-12s", wordp->action == Dot ? "" : ActionAsWord[wordp->u.krnl.fun]);
+                    if((sp = arrayKernel(sp, wordp)) == 0)
+                        return 0;
+                    printf("%.2f --> stack", sp->val.floating);
+                    ++wordp;
+                    break;
+                    }
                 case Eval:
                     {
                     printf("Eval        ");
@@ -1751,6 +2985,53 @@ static stackvalue* trcBody(forthMemory* mem)
                     ++wordp;
                     break;
                     }
+                case rMove:
+                case rPlus:
+                case rTimes:
+                case rSubtract:
+                case rDivide:
+                    {
+                    regop* rop = wordp->u.rop;
+                    switch(wordp->action)
+                        {
+                            case rMove: *(rop->r) = *(rop->a); break;
+                            case rPlus: rop->r->floating = rop->a->floating + rop->b->floating; break;
+                            case rTimes: rop->r->floating = rop->a->floating * rop->b->floating; break;
+                            case rSubtract: rop->r->floating = rop->a->floating - rop->b->floating; break;
+                            default: rop->r->floating = rop->a->floating / rop->b->floating;
+                        }
+                    printf("%.2f --> %s", rop->r->floating, regOperand(mem, rop, rop->r));
+                    sp = rop->sp;
+                    ++wordp;
+                    break;
+                    }
+                case rLess:
+                case rLess_equal:
+                case rMore_equal:
+                case rMore:
+                case rUnequal:
+                case rEqual:
+                    {
+                    regop* rop = wordp->u.rop;
+                    a = rop->a->floating;
+                    b = rop->b->floating;
+                    printf("%.2f %s %.2f", a, ActionAsWord[wordp->action] + 1, b);
+                    sp = rop->sp;
+                    switch(wordp->action)
+                        {
+                            case rLess: i = a >= b; break;
+                            case rLess_equal: i = a > b; break;
+                            case rMore_equal: i = a < b; break;
+                            case rMore: i = a <= b; break;
+                            case rUnequal: i = a == b; break;
+                            default: i = a != b;
+                        }
+                    if(i)
+                        wordp = word + wordp->offset;
+                    else
+                        ++wordp;
+                    break;
+                    }
                 case NoOp:
                     printf("NoOp        ");
                     ++wordp;
@@ -1836,6 +3117,8 @@ static stackvalue* ftrc(stackvalue* sp, forthword* wordp, double* ret)
         {
         stackvalue* sp2;
         sp = fsetArgs(sp, wordp->offset, thatmem);
+        if(!sp)
+            return 0;
         sp2 = trcBody(thatmem);
         if(sp2 && sp2 >= thatmem->stack)
             {
@@ -1953,7 +3236,7 @@ static int polish1(psk code, Boolean commentsAllowed)
                     errorprintf("calculation: lhs of $ is operator\n");
                     return -1;
                     }
-                else if(!strcmp(&(code->LEFT->u.sobj), "tbl") && StaticArray(code->RIGHT))
+                else if((!strcmp(&(code->LEFT->u.sobj), "tbl") || !strcmp(&(code->LEFT->u.sobj), "ftbl")) && StaticArray(code->RIGHT))
                     {
                     return 0;
                     }
@@ -1964,6 +3247,14 @@ static int polish1(psk code, Boolean commentsAllowed)
                         C = 0;
                     if(C == -1)
                         return -1;
+                    if(is_op(code->RIGHT)
+                       && Op(code->RIGHT) == COMMA
+                       && (!strcmp(&(code->LEFT->u.sobj), "map")
+                           || !strcmp(&(code->LEFT->u.sobj), "zip")
+                           || !strcmp(&(code->LEFT->u.sobj), "reduce")
+                           )
+                       )
+                        --C; /* The name of the function applied to the elements does not become a word. */
                     return 1 + C;
                     }
             case FUU:
@@ -2172,7 +3463,35 @@ static Boolean printmem(forthMemory* mem)
                 case EIdx:  printf(INDNT); printf("%*td"     " Pop Eidx\n", 5, wordp - mem->word); --In; break;
                 case Extent: printf(INDNT); printf("%*td"     " Pop extent\n", 5, wordp - mem->word); --In; break;
                 case Rank: printf(INDNT); printf("%*td"      " Pop rank\n", 5, wordp - mem->word); --In; break;
+                case Map:
+                case Zip:
+                case Reduce:
+                case Dot:
+                    printf(INDNT); printf("%*td" " Pop %-28s %s\n", 5, wordp - mem->word, Act, wordp->action == Dot ? "" : ActionAsWord[wordp->u.krnl.fun]);
+                    In -= (int)wordp->offset - 1;
+                    break;
                 case Eval: printf(INDNT); printf("%*td"      " eval\n", 5, wordp - mem->word); --In; break;
+                case rMove:
+                    printf(INDNT); printf("%*td" " %-32s %s = ", 5, wordp - mem->word, Act, regOperand(mem, wordp->u.rop, wordp->u.rop->r));
+                    printf("%s\n", regOperand(mem, wordp->u.rop, wordp->u.rop->a));
+                    break;
+                case rPlus:
+                case rTimes:
+                case rSubtract:
+                case rDivide:
+                    printf(INDNT); printf("%*td" " %-32s %s = ", 5, wordp - mem->word, Act, regOperand(mem, wordp->u.rop, wordp->u.rop->r));
+                    printf("%s %c ", regOperand(mem, wordp->u.rop, wordp->u.rop->a), "+*-/"[act - rPlus]);
+                    printf("%s\n", regOperand(mem, wordp->u.rop, wordp->u.rop->b));
+                    break;
+                case rLess:
+                case rLess_equal:
+                case rMore_equal:
+                case rMore:
+                case rUnequal:
+                case rEqual:
+                    printf(INDNT); printf("%*td" " %-24s " LONGnD "   %s ", 5, wordp - mem->word, Act, 5, (LONG)(wordp->offset), regOperand(mem, wordp->u.rop, wordp->u.rop->a));
+                    printf("%s\n", regOperand(mem, wordp->u.rop, wordp->u.rop->b));
+                    break;
                 case NoOp:
                     naam = "";
                     printf(INDNT); printf("%*td" " %-32s %s\n", 5, wordp - mem->word, "NoOp", naam);
@@ -2381,7 +3700,7 @@ static psk FractionNode(double val)
     return res;
     }
 
-static psk eksportArray(forthvalue* val, size_t rank, size_t* extent)
+static psk eksportArray(fortharray* a, size_t val, size_t rank, size_t* extent)
     {
     psk res;
     psk head = createOperatorNode(COMMA);
@@ -2396,9 +3715,9 @@ static psk eksportArray(forthvalue* val, size_t rank, size_t* extent)
             {
             head->RIGHT = createOperatorNode(WHITE);
             head = head->RIGHT;
-            head->LEFT = eksportArray(val, rank - 1, extent);
+            head->LEFT = eksportArray(a, val, rank - 1, extent);
             }
-        head->RIGHT = eksportArray(val, rank - 1, extent);
+        head->RIGHT = eksportArray(a, val, rank - 1, extent);
         }
     else
         { /* Export list of values. */
@@ -2406,9 +3725,9 @@ static psk eksportArray(forthvalue* val, size_t rank, size_t* extent)
             {
             head->RIGHT = createOperatorNode(WHITE);
             head = head->RIGHT;
-            head->LEFT = xprtfnc(val->floating);
+            head->LEFT = xprtfnc(getElement(a, val));
             }
-        head->RIGHT = xprtfnc(val->floating);
+        head->RIGHT = xprtfnc(getElement(a, val));
         }
     return res;
     }
@@ -2474,7 +3793,7 @@ static Boolean eksport(struct typedObjectnode* This, ppsk arg)
                     if(a)
                         {
                         psk res = 0;
-                        res = eksportArray(a->pval, a->rank, a->extent);
+                        res = eksportArray(a, 0, a->rank, a->extent);
                         if(res)
                             {
                             wipe(*arg);
@@ -2489,6 +3808,110 @@ static Boolean eksport(struct typedObjectnode* This, ppsk arg)
     return TRUE;
     }
 
+static void unbindArray(fortharray* arr)
+    {
+#if MAPPEDARRAYS
+    munmap(arr->mapping, arr->mappingsize);
+#endif
+    arr->mapping = 0;
+    arr->mappingsize = 0;
+    arr->pval = 0;
+    }
+
+#if MAPPEDARRAYS
+/* A file bound to an array starts with this header, followed by the extents as
+   64-bit numbers, first index first, and then the elements, the last index
+   running fastest. Numbers have the byte order of the machine. */
+typedef struct arrayheader
+    {
+    char magic[4]; /* "UFPA" */
+    uint32_t elementsize; /* 8 for doubles, 4 for 32-bit floats */
+    uint64_t rank;
+    } arrayheader;
+
+static Boolean bindArray(fortharray* arr, const char* filename)
+/* Let the elements of arr be the contents of the file, so that reading and
+   writing elements reads and writes the file. A file that does not exist is
+   created with the current contents of the array. An existing file must have
+   the element type, rank and extents of the array. Changes to a file that
+   cannot be written are kept in memory. */
+    {
+    size_t rank = arr->rank;
+    size_t header = sizeof(arrayheader) + rank * sizeof(uint64_t);
+    size_t bytes = arr->size * elementSize(arr);
+    Boolean created = FALSE;
+    Boolean writable = TRUE;
+    struct stat st;
+    void* map;
+    int fd = open(filename, O_RDWR);
+    if(fd < 0)
+        {
+        fd = open(filename, O_RDONLY);
+        writable = FALSE;
+        }
+    if(fd < 0)
+        {
+        fd = open(filename, O_RDWR | O_CREAT | O_EXCL, 0666);
+        created = TRUE;
+        writable = TRUE;
+        }
+    if(fd < 0)
+        {
+        errorprintf("bind: cannot open or create \"%s\".\n", filename);
+        return FALSE;
+        }
+    if(created ? ftruncate(fd, (off_t)(header + bytes)) != 0
+       : fstat(fd, &st) != 0 || (size_t)st.st_size != header + bytes)
+        {
+        errorprintf("bind: \"%s\" does not have the size of array \"%s\".\n", filename, arr->name);
+        close(fd);
+        if(created)
+            unlink(filename);
+        return FALSE;
+        }
+    map = mmap(0, header + bytes, PROT_READ | PROT_WRITE, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        {
+        errorprintf("bind: cannot map \"%s\" into memory.\n", filename);
+        if(created)
+            unlink(filename);
+        return FALSE;
+        }
+    arrayheader* head = (arrayheader*)map;
+    uint64_t* extent = (uint64_t*)(head + 1);
+    if(created)
+        {
+        memcpy(head->magic, "UFPA", 4);
+        head->elementsize = (uint32_t)elementSize(arr);
+        head->rank = rank;
+        for(size_t k = 0; k < rank; ++k)
+            extent[k] = arr->extent[rank - 1 - k];
+        memcpy((char*)map + header, arr->pval, bytes);
+        }
+    else
+        {
+        Boolean ok = !memcmp(head->magic, "UFPA", 4) && head->elementsize == elementSize(arr) && head->rank == rank;
+        for(size_t k = 0; ok && k < rank; ++k)
+            ok = extent[k] == arr->extent[rank - 1 - k];
+        if(!ok)
+            {
+            errorprintf("bind: \"%s\" does not have the element type, rank and extents of array \"%s\".\n", filename, arr->name);
+            munmap(map, header + bytes);
+            return FALSE;
+            }
+        }
+    if(arr->mapping)
+        unbindArray(arr);
+    else
+        bfree(arr->pval);
+    arr->pval = (forthvalue*)((char*)map + header);
+    arr->mapping = map;
+    arr->mappingsize = header + bytes;
+    return TRUE;
+    }
+#endif
+
 static Boolean shortcutJumpChains(forthword* wordp)
     {
     forthword* wstart = wordp;
@@ -3296,15 +4719,641 @@ static int removeNoOp(forthMemory* mem, int length)
                 {
                 if(wordp->action != NoOp)
                     {
-                    *newword++ = *wordp;
+                    *newword++ = *wordp;
+                    }
+                }
+            *newword = *wordp;
+            bfree(wstart);
+            }
+        free(deltaoffset);
+        }
+    return newlength;
+    }
+
+/* Register words
+
+registerize() is the last optimization. It rewrites the words into a
+register-based, three-address form: r = a op b, where r, a and b are addresses
+of variables, of constants or of slots on the stack. That is possible if the
+depth of the stack is known at each word. Then the n-th value on the stack
+always lives in mem->stack[n], just as each variable always lives at the same
+address. Pushing a variable or a constant only to use it in the next operation
+does not write anything to the stack.
+A register word also sets sp to what it would have been in the stack code, so
+register words and stack words can follow each other. Functions with words
+that change the depth of the stack in ways that are not known when compiling
+keep their stack code. */
+
+#define NOREGWORD ((size_t)-1)
+
+static int branchKind(actionType action)
+/* 0: no jump, 1: conditional jump, 2: unconditional jump, 3: end */
+    {
+    switch(action)
+        {
+            case Fless:
+            case Fless_equal:
+            case Fmore_equal:
+            case Fmore:
+            case Funequal:
+            case Fequal:
+            case FlessP:
+            case Fless_equalP:
+            case Fmore_equalP:
+            case FmoreP:
+            case FunequalP:
+            case FequalP:
+            case rLess:
+            case rLess_equal:
+            case rMore_equal:
+            case rMore:
+            case rUnequal:
+            case rEqual:
+                return 1;
+            case var2stackBranch:
+            case stack2varBranch:
+            case Branch:
+            case PopBranch:
+            case valPushBranch:
+            case val2stackBranch:
+                return 2;
+            case TheEnd:
+                return 3;
+            default:
+                return 0;
+        }
+    }
+
+static Boolean stackEffect(forthword* wordp, int* need, int* effect)
+/* How many values the word needs on the stack and how it changes the depth of
+   the stack. FALSE if that is not known before running. */
+    {
+    *need = 0;
+    *effect = 0;
+    switch(wordp->action)
+        {
+            case TheEnd:
+            case Branch:
+            case NoOp:
+            case Eval:
+                return TRUE;
+            case varPush:
+            case valPush:
+            case valPushBranch:
+            case ArrElmValPush:
+                *effect = 1;
+                return TRUE;
+            case var2stack:
+            case var2stackBranch:
+            case stack2var:
+            case stack2varBranch:
+            case stack2ArrElm:
+            case val2stack:
+            case val2stackBranch:
+            case varPlus:
+            case valPlus:
+            case varTimes:
+            case valTimes:
+            case varSubtract:
+            case valSubtract:
+            case varDivide:
+            case valDivide:
+            case Rank:
+                *need = 1;
+                return TRUE;
+            case Pop:
+            case PopBranch:
+            case Out:
+            case Outln:
+                *need = 1;
+                *effect = -1;
+                return TRUE;
+            case Fless:
+            case Fless_equal:
+            case Fmore_equal:
+            case Fmore:
+            case Funequal:
+            case Fequal:
+            case Plus:
+            case Times:
+            case Subtract:
+            case Divide:
+            case Atan2:
+            case Fdim:
+            case Fmax:
+            case Fmin:
+            case Fmod:
+            case Hypot:
+            case Pow:
+            case Extent:
+                *need = 2;
+                *effect = -1;
+                return TRUE;
+            case FlessP:
+            case Fless_equalP:
+            case Fmore_equalP:
+            case FmoreP:
+            case FunequalP:
+            case FequalP:
+                *need = 2;
+                *effect = -2;
+                return TRUE;
+            case Afunction: /* fsetArgs() takes at most as many values as there are parameters */
+                {
+                forthMemory* that = wordp->u.that;
+                if(that == 0)
+                    return FALSE;
+                *need = (int)wordp->offset;
+                *effect = 1 - (int)(wordp->offset < that->nparameters ? wordp->offset : that->nparameters);
+                return TRUE;
+                }
+            case Idx: /* array and indices */
+            case QIdx: /* value, array and indices, the value stays */
+                *need = (int)wordp->offset;
+                *effect = -(int)wordp->offset;
+                return TRUE;
+            case EIdx:
+            case Tbl:
+            case Map:
+            case Zip:
+            case Reduce:
+            case Dot:
+                *need = (int)wordp->offset;
+                *effect = 1 - (int)wordp->offset;
+                return TRUE;
+            case rMove:
+            case rPlus:
+            case rTimes:
+            case rSubtract:
+            case rDivide:
+            case rLess:
+            case rLess_equal:
+            case rMore_equal:
+            case rMore:
+            case rUnequal:
+            case rEqual:
+                return FALSE; /* already done */
+            default:
+                if(Acos <= wordp->action && wordp->action <= Drand)
+                    {
+                    *need = 1;
+                    return TRUE;
+                    }
+                return FALSE;
+        }
+    }
+
+static int* stackDepths(forthword* word, size_t n)
+/* The depth of the stack before each word, -1 for unreachable words.
+   0 if the depth is not known for all reachable words. */
+    {
+    int* depth = (int*)bmalloc(n * sizeof(int));
+    size_t* todo = (size_t*)bmalloc(n * sizeof(size_t));
+    size_t ntodo = 0;
+    size_t i;
+    Boolean ok = depth != 0 && todo != 0;
+    if(ok)
+        {
+        for(i = 0; i < n; ++i)
+            depth[i] = -1;
+        depth[0] = 0;
+        todo[ntodo++] = 0;
+        }
+    while(ok && ntodo > 0)
+        {
+        int need;
+        int effect;
+        int after;
+        size_t next[2];
+        int nnext = 0;
+        forthword* wordp;
+        i = todo[--ntodo];
+        wordp = word + i;
+        if(!stackEffect(wordp, &need, &effect) || depth[i] < need)
+            {
+            ok = FALSE;
+            break;
+            }
+        after = depth[i] + effect;
+        switch(branchKind(wordp->action))
+            {
+                case 0:
+                    next[nnext++] = i + 1;
+                    break;
+                case 1:
+                    next[nnext++] = i + 1;
+                    next[nnext++] = wordp->offset;
+                    break;
+                case 2:
+                    next[nnext++] = wordp->offset;
+                    break;
+                default:
+                    ;
+            }
+        while(nnext > 0)
+            {
+            size_t j = next[--nnext];
+            if(j >= n)
+                ok = FALSE;
+            else if(depth[j] < 0)
+                {
+                depth[j] = after;
+                todo[ntodo++] = j;
+                }
+            else if(depth[j] != after)
+                ok = FALSE;
+            }
+        }
+    if(todo)
+        bfree(todo);
+    if(!ok && depth)
+        {
+        bfree(depth);
+        depth = 0;
+        }
+    return depth;
+    }
+
+static Boolean setStack(forthMemory* mem)
+/* Allocate the stack, exactly as deep as the deepest point. The interpreter
+   does not check for overflow, so code for which the depth of the stack is
+   not known at each word is rejected. */
+    {
+    forthword* word = mem->word;
+    size_t n;
+    size_t size = 1; /* fcalculate() reads the first slot */
+    int* depth;
+    for(n = 1; word[n - 1].action != TheEnd; ++n)
+        ;
+    depth = stackDepths(word, n);
+    if(depth == 0)
+        {
+        errorprintf("Cannot determine the depth of the stack.\n");
+        return FALSE;
+        }
+    for(size_t i = 0; i < n; ++i)
+        {
+        int need;
+        int effect;
+        if(depth[i] >= 0 && stackEffect(word + i, &need, &effect))
+            {
+            if(effect > 0)
+                need = depth[i] + effect;
+            else
+                need = depth[i];
+            if((size_t)need > size)
+                size = (size_t)need;
+            }
+        }
+    bfree(depth);
+    mem->stack = (stackvalue*)bmalloc(size * sizeof(stackvalue));
+    if(mem->stack == 0)
+        {
+        errorprintf("Cannot allocate memory for the stack.\n");
+        return FALSE;
+        }
+    memset(mem->stack, 0, size * sizeof(stackvalue));
+    mem->stacksize = size;
+    mem->sp = mem->stack;
+    return TRUE;
+    }
+
+typedef enum { inSlot, atAddress, isConstant } regkind;
+
+typedef struct regsym /* where the value of a position on the stack is */
+    {
+    regkind kind;
+    forthvalue* p; /* atAddress */
+    forthvalue k; /* isConstant */
+    } regsym;
+
+typedef struct regstate
+    {
+    forthMemory* mem;
+    forthword* out; /* the new words */
+    size_t nout;
+    size_t maxout;
+    regop* rop; /* operands of the new register words */
+    size_t nrop;
+    regsym* sym; /* one for each slot on the stack */
+    int d; /* depth of the stack */
+    int spdepth; /* depth of the stack according to sp when running */
+    size_t lastreg; /* last new word, if it is a register word that does not jump */
+    } regstate;
+
+static forthvalue* regSlot(regstate* s, int k)
+    {
+    return &(s->mem->stack[k].val);
+    }
+
+static regop* regWord(regstate* s, actionType action)
+    {
+    forthword* wordp = s->out + s->nout;
+    regop* rop = s->rop + s->nrop++;
+    assert(s->nout < s->maxout);
+    memset(wordp, 0, sizeof(forthword));
+    memset(rop, 0, sizeof(regop));
+    wordp->action = action;
+    wordp->u.rop = rop;
+    s->lastreg = s->nout++;
+    return rop;
+    }
+
+static void regSetSp(regstate* s, regop* rop, int d)
+    {
+    rop->sp = s->mem->stack + d - 1;
+    s->spdepth = d;
+    }
+
+static forthvalue* regOperandOf(regstate* s, int k, regop* rop, int j)
+/* Address of the value at position k on the stack, as operand j of rop. */
+    {
+    switch(s->sym[k].kind)
+        {
+            case atAddress:
+                return s->sym[k].p;
+            case isConstant:
+                rop->k[j] = s->sym[k].k;
+                return rop->k + j;
+            default:
+                return regSlot(s, k);
+        }
+    }
+
+static void regMaterialize(regstate* s, int k)
+/* Write the value at position k to its slot on the stack. */
+    {
+    if(s->sym[k].kind != inSlot)
+        {
+        regop* rop = regWord(s, rMove);
+        rop->a = regOperandOf(s, k, rop, 0);
+        rop->r = regSlot(s, k);
+        regSetSp(s, rop, s->d);
+        s->sym[k].kind = inSlot;
+        }
+    }
+
+static void regProtect(regstate* s, forthvalue* var)
+/* var is going to change. Positions on the stack that still refer to var get
+   their own copy. */
+    {
+    for(int k = 0; k < s->d; ++k)
+        if(s->sym[k].kind == atAddress && s->sym[k].p == var)
+            regMaterialize(s, k);
+    }
+
+static Boolean regSync(regstate* s)
+/* Before a stack word, jump or label: all values in their slots, sp right. */
+    {
+    for(int k = 0; k < s->d; ++k)
+        regMaterialize(s, k);
+    if(s->spdepth != s->d)
+        {
+        if(s->lastreg != NOREGWORD && s->lastreg + 1 == s->nout)
+            regSetSp(s, s->out[s->lastreg].u.rop, s->d);
+        else
+            {
+            if(s->spdepth < s->d)
+                return FALSE;
+            for(; s->spdepth > s->d; --s->spdepth)
+                {
+                assert(s->nout < s->maxout);
+                memset(s->out + s->nout, 0, sizeof(forthword));
+                s->out[s->nout++].action = Pop;
+                }
+            }
+        }
+    return TRUE;
+    }
+
+static void regCopy(regstate* s, forthword* wordp)
+    {
+    assert(s->nout < s->maxout);
+    s->out[s->nout++] = *wordp;
+    s->lastreg = NOREGWORD;
+    }
+
+static void regArithmetic(regstate* s, actionType action, int k, forthvalue* b, forthvalue* bconst)
+/* S(k) = position k op position k+1, or op b, or op bconst */
+    {
+    regop* rop = regWord(s, action);
+    rop->a = regOperandOf(s, k, rop, 0);
+    if(b)
+        rop->b = b;
+    else if(bconst)
+        {
+        rop->k[1] = *bconst;
+        rop->b = rop->k + 1;
+        }
+    else
+        rop->b = regOperandOf(s, k + 1, rop, 1);
+    rop->r = regSlot(s, k);
+    s->d = k + 1;
+    s->sym[k].kind = inSlot;
+    regSetSp(s, rop, s->d);
+    }
+
+static Boolean registerize(forthMemory* mem)
+    {
+    forthword* word = mem->word;
+    forthword* wordp;
+    size_t n;
+    size_t i;
+    int* depth;
+    size_t* newindex;
+    char* label;
+    regstate s;
+    Boolean ok = TRUE;
+    for(n = 1; word[n - 1].action != TheEnd; ++n)
+        ;
+    depth = stackDepths(word, n);
+    if(depth == 0)
+        return FALSE;
+    memset(&s, 0, sizeof(s));
+    s.mem = mem;
+    s.maxout = 2 * n + 1;
+    s.out = (forthword*)bmalloc(s.maxout * sizeof(forthword));
+    s.rop = (regop*)bmalloc(s.maxout * sizeof(regop));
+    s.sym = (regsym*)bmalloc((mem->stacksize + 1) * sizeof(regsym));
+    newindex = (size_t*)bmalloc(n * sizeof(size_t));
+    label = (char*)bmalloc(n);
+    if(!s.out || !s.rop || !s.sym || !newindex || !label)
+        ok = FALSE;
+    else
+        {
+        memset(label, 0, n);
+        for(i = 0; i < n; ++i)
+            {
+            int kind = branchKind(word[i].action);
+            if(depth[i] >= 0 && (kind == 1 || kind == 2))
+                label[word[i].offset] = 1;
+            }
+        s.lastreg = NOREGWORD;
+        }
+    for(i = 0; ok && i < n; ++i)
+        {
+        int need;
+        int effect;
+        wordp = word + i;
+        if(depth[i] < 0)
+            { /* unreachable */
+            newindex[i] = s.nout;
+            regCopy(&s, wordp);
+            continue;
+            }
+        if(label[i] || i == 0)
+            {
+            if(i > 0 && !regSync(&s))
+                {
+                ok = FALSE;
+                break;
+                }
+            s.d = depth[i];
+            for(int k = 0; k < s.d; ++k)
+                s.sym[k].kind = inSlot;
+            s.spdepth = s.d;
+            s.lastreg = NOREGWORD;
+            }
+        assert(s.d == depth[i]);
+        newindex[i] = s.nout;
+        switch(wordp->action)
+            {
+                case varPush:
+                    s.sym[s.d].kind = atAddress;
+                    s.sym[s.d++].p = wordp->u.valp;
+                    break;
+                case valPush:
+                    s.sym[s.d].kind = isConstant;
+                    s.sym[s.d++].k = wordp->u.val;
+                    break;
+                case var2stack:
+                    s.sym[s.d - 1].kind = atAddress;
+                    s.sym[s.d - 1].p = wordp->u.valp;
+                    break;
+                case val2stack:
+                    s.sym[s.d - 1].kind = isConstant;
+                    s.sym[s.d - 1].k = wordp->u.val;
+                    break;
+                case Pop:
+                    --s.d;
+                    break;
+                case stack2var:
+                    {
+                    forthvalue* var = wordp->u.valp;
+                    regsym* top = s.sym + s.d - 1;
+                    if(top->kind == atAddress && top->p == var)
+                        break; /* !x:?x */
+                    regProtect(&s, var);
+                    if(top->kind == inSlot
+                       && s.lastreg != NOREGWORD
+                       && s.lastreg + 1 == s.nout
+                       && s.out[s.lastreg].action != rMove
+                       && s.out[s.lastreg].u.rop->r == regSlot(&s, s.d - 1))
+                        { /* Let the operation write to var instead of to the stack. */
+                        s.out[s.lastreg].u.rop->r = var;
+                        top->kind = atAddress;
+                        top->p = var;
+                        }
+                    else
+                        {
+                        regop* rop = regWord(&s, rMove);
+                        rop->a = regOperandOf(&s, s.d - 1, rop, 0);
+                        rop->r = var;
+                        regSetSp(&s, rop, s.d);
+                        }
+                    break;
+                    }
+                case Plus:
+                case Times:
+                case Subtract:
+                case Divide:
+                    regArithmetic(&s, wordp->action == Plus ? rPlus : wordp->action == Times ? rTimes : wordp->action == Subtract ? rSubtract : rDivide, s.d - 2, 0, 0);
+                    break;
+                case varPlus:
+                case varTimes:
+                case varSubtract:
+                case varDivide:
+                    regArithmetic(&s, wordp->action == varPlus ? rPlus : wordp->action == varTimes ? rTimes : wordp->action == varSubtract ? rSubtract : rDivide, s.d - 1, wordp->u.valp, 0);
+                    break;
+                case valPlus:
+                case valTimes:
+                case valSubtract:
+                case valDivide:
+                    regArithmetic(&s, wordp->action == valPlus ? rPlus : wordp->action == valTimes ? rTimes : wordp->action == valSubtract ? rSubtract : rDivide, s.d - 1, 0, &(wordp->u.val));
+                    break;
+                case Fless:
+                case Fless_equal:
+                case Fmore_equal:
+                case Fmore:
+                case Funequal:
+                case Fequal:
+                case FlessP:
+                case Fless_equalP:
+                case Fmore_equalP:
+                case FmoreP:
+                case FunequalP:
+                case FequalP:
+                    {
+                    Boolean popTwice = wordp->action >= FlessP;
+                    int keep = s.d - (popTwice ? 2 : 1); /* depth after the word */
+                    regop* rop;
+                    for(int k = 0; k < keep; ++k)
+                        regMaterialize(&s, k);
+                    rop = regWord(&s, (actionType)(rLess + (wordp->action - (popTwice ? FlessP : Fless))));
+                    rop->a = regOperandOf(&s, s.d - 2, rop, 0);
+                    rop->b = regOperandOf(&s, s.d - 1, rop, 1);
+                    s.out[s.nout - 1].offset = wordp->offset;
+                    s.d = keep;
+                    regSetSp(&s, rop, s.d);
+                    s.lastreg = NOREGWORD;
+                    break;
                     }
-                }
-            *newword = *wordp;
-            bfree(wstart);
+                case var2stackBranch:
+                case val2stackBranch:
+                    s.sym[s.d - 1].kind = inSlot; /* will be overwritten */
+                    /* fall through */
+                default:
+                    if(!stackEffect(wordp, &need, &effect) || !regSync(&s))
+                        {
+                        ok = FALSE;
+                        break;
+                        }
+                    regCopy(&s, wordp);
+                    s.d += effect;
+                    for(int k = 0; k < s.d; ++k)
+                        s.sym[k].kind = inSlot;
+                    s.spdepth = s.d;
             }
-        free(deltaoffset);
+        if(s.nout + 1 >= s.maxout)
+            ok = FALSE;
         }
-    return newlength;
+    if(ok && s.nrop > 0)
+        {
+        for(i = 0; i < s.nout; ++i)
+            if(branchKind(s.out[i].action) == 1 || branchKind(s.out[i].action) == 2)
+                s.out[i].offset = (unsigned int)newindex[s.out[i].offset];
+        if(mem->regops)
+            bfree(mem->regops);
+        mem->regops = s.rop;
+        s.rop = 0;
+        bfree(mem->word);
+        mem->word = s.out;
+        s.out = 0;
+        }
+    else
+        ok = FALSE;
+    if(s.out)
+        bfree(s.out);
+    if(s.rop)
+        bfree(s.rop);
+    if(s.sym)
+        bfree(s.sym);
+    if(newindex)
+        bfree(newindex);
+    if(label)
+        bfree(label);
+    bfree(depth);
+    return ok;
     }
 
 static Boolean combinePopThenPop(forthword* wstart, char* marks)
@@ -3439,7 +5488,7 @@ static Boolean setArity(forthword* wordp, psk code, unsigned int expectedArity)
     return TRUE;
     }
 
-static fortharray* haveArray(forthMemory* forthstuff, psk declaration, Boolean in_function)
+static fortharray* haveArray(forthMemory* forthstuff, psk declaration, elementType type, Boolean in_function)
     {
     psk pname = 0;
     psk extents = 0;
@@ -3470,6 +5519,8 @@ static fortharray* haveArray(forthMemory* forthstuff, psk declaration, Boolean i
         }
 
     fortharray* a = getOrCreateArrayPointer(&(forthstuff->arr), &(pname->u.sobj), 0);
+    if(a)
+        a->type = type;
     if(!in_function && a && extents)
         {
         size_t rank = 1;
@@ -3578,7 +5629,7 @@ static int argcount(psk rhs)
             }
         else
             {
-            static int deep;
+            static THREADLOCAL int deep;
             deep = argcount(rhs->RIGHT);
             if(deep <= 0)
                 {
@@ -3631,6 +5682,88 @@ static fortharray* namedArray(char* name, forthMemory* mem, psk node)
         }
     }
 
+static forthword* polish2(forthMemory* mem, jumpblock* jumps, psk code, forthword* wordp, Boolean commentsAllowed);
+
+static forthword* polishKernel(forthMemory* mem, jumpblock* jumps, psk code, forthword* wordp, actionType action)
+/* map$(<function>,A,B), zip$(<function>,A,B,C), reduce$(<function>,A) and
+dot$(A,B). A is an array, B and C are arrays or numbers. The operands are
+pushed, the name of the function is stored in the word itself. */
+    {
+    char* name = &code->LEFT->u.sobj;
+    psk rhs = code->RIGHT;
+    unsigned int operands = action == Zip ? 3 : action == Reduce ? 1 : 2;
+    unsigned int arity = 0;
+    kernel krnl = { NoOp, 0 };
+    if(action != Dot)
+        {
+        Etriple* ep;
+        if(!is_op(rhs) || Op(rhs) != COMMA || is_op(rhs->LEFT))
+            {
+            errorprintf("\"%s\": first argument must be the name of a function.\n", name);
+            return 0;
+            }
+        for(ep = etriples; ep->name != 0 && strcmp(ep->name, &(rhs->LEFT->u.sobj)); ++ep)
+            ;
+        if(ep->name != 0)
+            krnl.fun = ep->action;
+        if(action == Map ? elementArity(krnl.fun) != 1
+           : action == Zip ? elementArity(krnl.fun) != 2
+           : (krnl.fun != Plus && krnl.fun != Times && krnl.fun != Fmax && krnl.fun != Fmin)
+           )
+            {
+            errorprintf("\"%s\" cannot apply \"%s\" to array elements.\n", name, &(rhs->LEFT->u.sobj));
+            return 0;
+            }
+        rhs = rhs->RIGHT;
+        }
+    for(;;)
+        {
+        psk operand = (is_op(rhs) && Op(rhs) == COMMA) ? rhs->LEFT : rhs;
+        if(arity < operands)
+            {
+            if(!is_op(operand) && !okatomicarg(operand))
+                {
+                fortharray* arr = namedArray(name, mem, operand);
+                if(arr == 0)
+                    {
+                    errorprintf("%s: Array \"%s\" is not declared\n", name, &(operand->u.sobj));
+                    return 0;
+                    }
+                wordp->u.arrp = arr;
+                wordp->action = valPush;
+                wordp->offset = 0;
+                ++wordp;
+                }
+            else if(arity == 0 || action == Reduce || action == Dot)
+                {
+                showProblematicNode("Array name expected: ", operand);
+                return 0;
+                }
+            else
+                {
+                wordp = polish2(mem, jumps, operand, wordp, FALSE);
+                if(wordp == 0)
+                    return 0; /* Something wrong happened. */
+                krnl.scalars |= 1u << arity;
+                }
+            }
+        ++arity;
+        if(!is_op(rhs) || Op(rhs) != COMMA)
+            break;
+        rhs = rhs->RIGHT;
+        }
+    if(arity != operands)
+        {
+        errorprintf("\"%s\" expects %u arrays or numbers, %u found.\n", name, operands, arity);
+        return 0;
+        }
+    wordp->action = action;
+    wordp->offset = arity;
+    wordp->u.krnl = krnl;
+    mustpop = epop;
+    return ++wordp;
+    }
+
 static forthword* polish2(forthMemory* mem, jumpblock* jumps, psk code, forthword* wordp, Boolean commentsAllowed)
 /* jumps points to 5 words as explained for AND and OR */
     {
@@ -3986,27 +6119,41 @@ static forthword* polish2(forthMemory* mem, jumpblock* jumps, psk code, forthwor
                 Etriple* ep = etriples;
                 char* name = &code->LEFT->u.sobj;
                 psk rhs = code->RIGHT;
-                if(!strcmp(name, "tbl"))
+                if(!strcmp(name, "map"))
+                    return polishKernel(mem, jumps, code, wordp, Map);
+                else if(!strcmp(name, "zip"))
+                    return polishKernel(mem, jumps, code, wordp, Zip);
+                else if(!strcmp(name, "reduce"))
+                    return polishKernel(mem, jumps, code, wordp, Reduce);
+                else if(!strcmp(name, "dot"))
+                    return polishKernel(mem, jumps, code, wordp, Dot);
+                else if(!strcmp(name, "tbl") || !strcmp(name, "ftbl"))
                     { /* Check that name is array name and that arity is correct. */
                     if(is_op(rhs))
                         {
-                        fortharray* arr = namedArray("tbl", mem, rhs->LEFT);
+                        elementType type = name[0] == 'f' ? Float32 : Float64;
+                        fortharray* arr = namedArray(name, mem, rhs->LEFT);
                         if(arr == 0)
                             {
-                            arr = haveArray(mem, rhs, FALSE);
+                            arr = haveArray(mem, rhs, type, FALSE);
                             if(arr != 0 && arr->size != 0)
                                 return wordp; /* Arguments are fixed. Memory is allocated foNo nr array cells. No need to reevaluate. */
                             }
+                        else if(arr->type != type)
+                            {
+                            errorprintf("%s:Array \"%s\" is declared with %s elements.\n", name, arr->name, arr->type == Float32 ? "32-bit" : "64-bit");
+                            return 0;
+                            }
 
                         if(arr == 0)
                             {
-                            errorprintf("tbl:Array \"%s\"is not declared\n", &(rhs->LEFT->u.sobj));
+                            errorprintf("%s:Array \"%s\"is not declared\n", name, &(rhs->LEFT->u.sobj));
                             return 0;
                             }
                         }
                     else
                         {
-                        errorprintf("Right hand side of \"tbl$\" must be at least two arguments: an array name and one or more extents.\n");
+                        errorprintf("Right hand side of \"%s$\" must be at least two arguments: an array name and one or more extents.\n", name);
                         return 0;
                         }
                     }
@@ -4208,7 +6355,10 @@ static forthword* polish2(forthMemory* mem, jumpblock* jumps, psk code, forthwor
                                 errorprintf("Argument error in call to \"%s\".\n", name);
                                 return 0;
                                 }
-                            mustpop = enopop;
+                            /* Each argument pushed a value. Does a value remain? */
+                            int need;
+                            int effect;
+                            mustpop = stackEffect(wordp, &need, &effect) && (int)wordp->offset + effect > 0 ? epop : enopop;
                             return ++wordp;
                             }
                         }
@@ -4368,7 +6518,7 @@ static Boolean setparm(size_t Ndecl, forthMemory* forthstuff, psk declaration, B
     parameter* npar;
     if(is_op(declaration->LEFT))
         {
-        errorprintf("Parameter declaration requires 's' or 'a'.\n");
+        errorprintf("Parameter declaration requires 's', 'a' or 'f'.\n");
         return FALSE;
         }
 
@@ -4395,7 +6545,7 @@ static Boolean setparm(size_t Ndecl, forthMemory* forthstuff, psk declaration, B
         }
     else /* array */
         {
-        fortharray* a = haveArray(forthstuff, declaration->RIGHT, in_function);
+        fortharray* a = haveArray(forthstuff, declaration->RIGHT, declaration->LEFT->u.sobj == 'f' ? Float32 : Float64, in_function);
         if(a)
             {
             npar = forthstuff->parameters + Ndecl;
@@ -4512,6 +6662,24 @@ static Boolean functiondie(forthMemory* mem)
         bfree(mem->word);
         mem->word = 0;
         }
+    if(mem->regops)
+        {
+        bfree(mem->regops);
+        mem->regops = 0;
+        }
+    if(mem->counts)
+        {
+        bfree(mem->counts);
+        mem->counts = 0;
+        }
+    if(mem->stack)
+        {
+        bfree(mem->stack);
+        mem->stack = 0;
+        }
+#if JITCOMPILE
+    jitFree(mem);
+#endif
     bfree(mem);
     return TRUE;
     }
@@ -4577,7 +6745,6 @@ static forthMemory* calcnew(psk arg, forthMemory* parent, Boolean in_function)
                 {
                 memset(forthstuff->word, 0, length * sizeof(forthword));
                 forthstuff->wordp = forthstuff->word;
-                forthstuff->sp = forthstuff->stack;
                 forthstuff->parameters = 0;
                 if(declarations)
                     {
@@ -4643,7 +6810,10 @@ static forthMemory* calcnew(psk arg, forthMemory* parent, Boolean in_function)
 
                         lastword->action = TheEnd;
                         if(newval)
+                            {
                             wipe(fullcode);
+                            newval = 0;
+                            }
                         char* marks = calloc(length, sizeof(char));
                         if(marks)
                             {
@@ -4688,7 +6858,17 @@ static forthMemory* calcnew(psk arg, forthMemory* parent, Boolean in_function)
                                 }
                             free(marks);
                             }
-                        return forthstuff;
+                        if(setStack(forthstuff))
+                            {
+                            registerize(forthstuff);
+#if DIRECTTHREADING
+                            threadWords(forthstuff->word);
+#endif
+#if JITCOMPILE
+                            jitCompile(forthstuff);
+#endif
+                            return forthstuff;
+                            }
                         }
                     }
                 }
@@ -4703,7 +6883,8 @@ static forthMemory* calcnew(psk arg, forthMemory* parent, Boolean in_function)
                 }
             }
         }
-    wipe(fullcode);
+    if(newval)
+        wipe(fullcode);
     return 0; /* Something wrong happened. */
     }
 
@@ -4714,6 +6895,8 @@ static Boolean calculationnew(struct typedObjectnode* This, ppsk arg)
         forthMemory* forthstuff = calcnew((*arg)->RIGHT, 0, FALSE);
         if(forthstuff)
             {
+            if(is_op((*arg)->RIGHT) && Op((*arg)->RIGHT) == EQUALS)
+                forthstuff->source = same_as_w((*arg)->RIGHT);
             This->voiddata = forthstuff;
             return TRUE;
             }
@@ -4753,7 +6936,11 @@ static Boolean calcdie(forthMemory* mem)
                 curarr->extent = 0;
                 curarr->stride = 0;
                 }
-            if(curarr->pval)
+            if(curarr->mapping)
+                {
+                unbindArray(curarr);
+                }
+            else if(curarr->pval)
                 {
                 bfree(curarr->pval);
                 curarr->pval = 0;
@@ -4779,6 +6966,31 @@ static Boolean calcdie(forthMemory* mem)
             bfree(mem->name);
             mem->name = 0;
             }
+        if(mem->regops)
+            {
+            bfree(mem->regops);
+            mem->regops = 0;
+            }
+        if(mem->counts)
+            {
+            bfree(mem->counts);
+            mem->counts = 0;
+            }
+        if(mem->stack)
+            {
+            bfree(mem->stack);
+            mem->stack = 0;
+            }
+        if(mem->source)
+            {
+            wipe(mem->source);
+            mem->source = 0;
+            }
+        calcdie(mem->twin);
+        mem->twin = 0;
+#if JITCOMPILE
+        jitFree(mem);
+#endif
         bfree(mem);
         }
     return TRUE;
@@ -4786,7 +6998,387 @@ static Boolean calcdie(forthMemory* mem)
 
 static Boolean calculationdie(struct typedObjectnode* This, ppsk arg)
     {
-    return calcdie((forthMemory*)(This->voiddata));
+    forthMemory* mem = (forthMemory*)(This->voiddata);
+    if(mem != 0)
+        {
+        for(fortharray* arr = mem->arr; arr; arr = arr->next)
+            if(arr->exported)
+                {
+                errorprintf("Die: array \"%s\" is in use outside Bracmat.\n", arr->name);
+                return FALSE;
+                }
+        }
+    return calcdie(mem);
+    }
+
+static Boolean profileWords(forthMemory* mem, Boolean on)
+/* Start or stop counting the executions of the words of mem and of its
+   functions. While counting, calculate() and fcalculate() also add up how
+   often and how long each of them runs. */
+    {
+    if(mem == 0)
+        return TRUE;
+    size_t n;
+    for(n = 1; mem->word[n - 1].action != TheEnd; ++n)
+        ;
+    if(on)
+        {
+        if(mem->counts == 0)
+            mem->counts = (unsigned long*)bmalloc(n * sizeof(unsigned long));
+        if(mem->counts == 0)
+            return FALSE;
+        memset(mem->counts, 0, n * sizeof(unsigned long));
+        }
+#if DIRECTTHREADING
+    for(size_t i = 0; i < n; ++i)
+        mem->word[i].handler = handlerAddresses[on ? PROFILEHANDLER : mem->word[i].action];
+#endif
+    if(!on && mem->counts)
+        {
+        bfree(mem->counts);
+        mem->counts = 0;
+        }
+    mem->calls = 0;
+    mem->ticks = 0;
+    return profileWords(mem->functions, on) && profileWords(mem->nextFnc, on);
+    }
+
+static psk profileNode(int operator, psk left, psk right)
+    {
+    psk res = createOperatorNode(operator);
+    res->LEFT = left;
+    res->RIGHT = right;
+    return res;
+    }
+
+static psk profileNumber(unsigned long val)
+    {
+    char jotter[24];
+    sprintf(jotter, "%lu", val);
+    return scopy(jotter);
+    }
+
+static psk profileOf(forthMemory* mem)
+/* (<name>.<calls>.<microseconds>.(0.<word>.<count>) (1.<word>.<count>) ...)
+   for mem and each of its functions */
+    {
+    psk words = 0;
+    psk res;
+    size_t n;
+    for(n = 1; mem->word[n - 1].action != TheEnd; ++n)
+        ;
+    while(n-- > 0)
+        {
+        psk word = profileNode(DOT, profileNumber((unsigned long)n)
+                               , profileNode(DOT, scopy(ActionAsWord[mem->word[n].action])
+                                             , profileNumber(mem->counts[n])));
+        words = words ? profileNode(WHITE, word, words) : word;
+        }
+    res = profileNode(DOT, scopy(mem->name == 0 ? "(main)" : mem->name)
+                      , profileNode(DOT, profileNumber(mem->calls)
+                                    , profileNode(DOT, profileNumber((unsigned long)((double)mem->ticks * 1.0e6 / CLOCKS_PER_SEC))
+                                                  , words)));
+    if(mem->functions)
+        res = profileNode(WHITE, res, profileOf(mem->functions));
+    if(mem->nextFnc)
+        res = profileNode(WHITE, res, profileOf(mem->nextFnc));
+    return res;
+    }
+
+static Boolean profile(struct typedObjectnode* This, ppsk arg)
+/* (calc..profile)$1 starts profiling, (calc..profile)$0 stops.
+   (calc..profile)$ returns the profile so far. */
+    {
+    forthMemory* mem = (forthMemory*)(This->voiddata);
+    psk Arg = (*arg)->RIGHT;
+    if(mem == 0 || is_op(Arg))
+        return FALSE;
+    if(Arg->u.sobj == '\0')
+        {
+        if(mem->counts == 0)
+            return FALSE;
+        psk res = profileOf(mem);
+        wipe(*arg);
+        *arg = res;
+        return TRUE;
+        }
+    if(!strcmp(&(Arg->u.sobj), "1"))
+        return profileWords(mem, TRUE);
+    if(!strcmp(&(Arg->u.sobj), "0"))
+        return profileWords(mem, FALSE);
+    return FALSE;
+    }
+
+static Boolean batchSequential(forthMemory* mem, psk* tuples, size_t n, double* results)
+    {
+    for(size_t i = 0; i < n; ++i)
+        {
+        stackvalue* sp;
+        if(mem->parameters && setArgs(mem, 0, tuples[i]) <= 0)
+            return FALSE;
+        sp = runBody(mem);
+        if(!sp || sp < mem->stack)
+            return FALSE;
+        results[i] = sp->val.floating;
+        }
+    return TRUE;
+    }
+
+#if CALCULATION_THREADS > 1
+#define BATCHMINIMUM 64 /* fewest argument lists per thread */
+
+static Boolean mustRunInMainThread(forthMemory* mem)
+/* A Tbl word allocates memory while calculating and an Eval word evaluates
+   Bracmat code. Only the main thread may do either. Only tbl$ with extents
+   that are not constant compiles to a Tbl word: an array with constant
+   extents is allocated during compilation, in polish2(). */
+    {
+    for(; mem; mem = mem->nextFnc)
+        {
+        forthword* wordp = mem->word;
+        for(; wordp->action != TheEnd; ++wordp)
+            if(wordp->action == Tbl || wordp->action == Eval)
+                return TRUE;
+        if(mustRunInMainThread(mem->functions))
+            return TRUE;
+        }
+    return FALSE;
+    }
+
+typedef struct batchjob /* what one thread does in batch() */
+    {
+    forthMemory* mem; /* the object or one of its twins */
+    const double* args; /* nparameters numbers per argument list */
+    double* results;
+    size_t first; /* the thread does first, first + step, first + 2 * step, ... */
+    size_t step;
+    size_t n;
+    Boolean ok;
+    } batchjob;
+
+static void* batchThread(void* arg)
+    {
+    batchjob* job = (batchjob*)arg;
+    forthMemory* mem = job->mem;
+    size_t np = mem->nparameters;
+    job->ok = TRUE;
+    for(size_t i = job->first; i < job->n; i += job->step)
+        {
+        stackvalue* sp;
+        for(size_t k = 0; k < np; ++k)
+            mem->parameters[k].u.v->val.floating = job->args[i * np + k];
+        sp = calculateBody(mem);
+        if(!sp || sp < mem->stack)
+            {
+            job->ok = FALSE;
+            break;
+            }
+        job->results[i] = sp->val.floating;
+        }
+    return 0;
+    }
+
+static size_t batchThreads(forthMemory* mem, size_t n)
+/* How many threads batch() can use. A twin is compiled from the same code as
+   mem, but has its own variables, arrays and stack. Twins are kept until the
+   object is destroyed. */
+    {
+    size_t nthreads = n / BATCHMINIMUM;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if(ncpu > 0 && nthreads > (size_t)ncpu)
+        nthreads = (size_t)ncpu;
+    if(nthreads > CALCULATION_THREADS)
+        nthreads = CALCULATION_THREADS;
+    if(nthreads < 2 || mem->source == 0 || mem->counts != 0 || mustRunInMainThread(mem))
+        return 1;
+    for(size_t k = 0; k < mem->nparameters; ++k)
+        if(mem->parameters[k].scalar_or_array != Scalar)
+            return 1;
+    for(fortharray* arr = mem->arr; arr; arr = arr->next)
+        if(arr->mapping)
+            return 1; /* The twins would not see the file. */
+    forthMemory* twin = mem;
+    for(size_t t = 1; t < nthreads; ++t)
+        {
+        if(twin->twin == 0)
+            {
+            twin->twin = calcnew(mem->source, 0, FALSE);
+            if(twin->twin == 0)
+                return t;
+            }
+        twin = twin->twin;
+        }
+    return nthreads;
+    }
+
+static Boolean batchParallel(forthMemory* mem, psk* tuples, size_t n, double* results, size_t nthreads)
+    {
+    size_t np = mem->nparameters;
+    double* args = np ? (double*)bmalloc(n * np * sizeof(double)) : 0;
+    batchjob* jobs = (batchjob*)bmalloc(nthreads * sizeof(batchjob));
+    pthread_t* threads = (pthread_t*)bmalloc(nthreads * sizeof(pthread_t));
+    Boolean ok = jobs != 0 && threads != 0 && (np == 0 || args != 0);
+    /* Only the main thread reads Bracmat data. */
+    for(size_t i = 0; ok && i < n; ++i)
+        {
+        if(np > 0 && setArgs(mem, 0, tuples[i]) <= 0)
+            ok = FALSE;
+        for(size_t k = 0; ok && k < np; ++k)
+            args[i * np + k] = mem->parameters[k].u.v->val.floating;
+        }
+    if(ok)
+        {
+        forthMemory* twin = mem;
+        size_t t;
+        for(t = 0; t < nthreads; ++t, twin = twin->twin)
+            {
+            jobs[t].mem = twin;
+            jobs[t].args = args;
+            jobs[t].results = results;
+            jobs[t].first = t;
+            jobs[t].step = nthreads;
+            jobs[t].n = n;
+            }
+        for(t = 1; t < nthreads; ++t)
+            if(pthread_create(threads + t, 0, batchThread, jobs + t) != 0)
+                break;
+        batchThread(jobs);
+        for(size_t u = 1; u < nthreads; ++u)
+            {
+            if(u < t)
+                pthread_join(threads[u], 0);
+            else
+                batchThread(jobs + u);
+            ok = ok && jobs[u].ok;
+            }
+        ok = ok && jobs[0].ok;
+        }
+    if(args)
+        bfree(args);
+    if(jobs)
+        bfree(jobs);
+    if(threads)
+        bfree(threads);
+    return ok;
+    }
+#endif
+
+static Boolean batch(struct typedObjectnode* This, ppsk arg)
+/* (calc..batch)$(<arguments> <arguments> ...) does (calc..go)$<arguments> for
+   each element of the list and returns the list of results. */
+    {
+    forthMemory* mem = (forthMemory*)(This->voiddata);
+    psk Arg = (*arg)->RIGHT;
+    psk list;
+    psk res = 0;
+    size_t n = 1;
+    size_t i;
+    if(mem == 0)
+        return FALSE;
+    if(!is_op(Arg) && Arg->u.sobj == '\0')
+        {
+        wipe(*arg);
+        *arg = same_as_w(&nilNode);
+        return TRUE;
+        }
+    for(list = Arg; is_op(list) && Op(list) == WHITE; list = list->RIGHT)
+        ++n;
+    psk* tuples = (psk*)bmalloc(n * sizeof(psk));
+    double* results = (double*)bmalloc(n * sizeof(double));
+    Boolean ok = tuples != 0 && results != 0;
+    if(ok)
+        {
+        for(i = 0, list = Arg; is_op(list) && Op(list) == WHITE; list = list->RIGHT)
+            tuples[i++] = list->LEFT;
+        tuples[i] = list;
+#if CALCULATION_THREADS > 1
+        size_t nthreads = batchThreads(mem, n);
+        if(nthreads > 1)
+            ok = batchParallel(mem, tuples, n, results, nthreads);
+        else
+#endif
+            ok = batchSequential(mem, tuples, n, results);
+        }
+    for(i = n; ok && i-- > 0;)
+        {
+        psk elem = calcResult(results[i]);
+        if(elem == 0)
+            ok = FALSE;
+        else if(res == 0)
+            res = elem;
+        else
+            {
+            psk white = createOperatorNode(WHITE);
+            if(white == 0)
+                {
+                wipe(elem);
+                ok = FALSE;
+                }
+            else
+                {
+                white->LEFT = elem;
+                white->RIGHT = res;
+                res = white;
+                }
+            }
+        }
+    if(tuples)
+        bfree(tuples);
+    if(results)
+        bfree(results);
+    if(!ok)
+        {
+        if(res)
+            wipe(res);
+        return FALSE;
+        }
+    wipe(*arg);
+    *arg = res;
+    return TRUE;
+    }
+
+static Boolean bindfile(struct typedObjectnode* This, ppsk arg)
+/* (calc..bind)$(<array name>,<file name>) maps the elements of the array onto
+   the file and returns the number of elements. */
+    {
+    forthMemory* mem = (forthMemory*)(This->voiddata);
+    psk Arg = (*arg)->RIGHT;
+    if(mem == 0)
+        return FALSE;
+    if(!is_op(Arg) || Op(Arg) != COMMA || is_op(Arg->LEFT) || is_op(Arg->RIGHT))
+        {
+        errorprintf("bind: arguments must be the name of an array and the name of a file.\n");
+        return FALSE;
+        }
+    fortharray* arr = getArrayPointer(&(mem->arr), &(Arg->LEFT->u.sobj));
+    if(arr == 0)
+        {
+        errorprintf("bind: array \"%s\" is not declared.\n", &(Arg->LEFT->u.sobj));
+        return FALSE;
+        }
+    if(arr->pval == 0 || arr->size == 0)
+        {
+        errorprintf("bind: the extents of array \"%s\" are not known.\n", arr->name);
+        return FALSE;
+        }
+    if(arr->exported)
+        {
+        errorprintf("bind: array \"%s\" is in use outside Bracmat.\n", arr->name);
+        return FALSE;
+        }
+#if MAPPEDARRAYS
+    if(!bindArray(arr, &(Arg->RIGHT->u.sobj)))
+        return FALSE;
+    psk res = IntegerNode((double)arr->size);
+    if(res == 0)
+        return FALSE;
+    wipe(*arg);
+    *arg = res;
+    return TRUE;
+#else
+    errorprintf("bind: files cannot be mapped into memory on this platform.\n");
+    return FALSE;
+#endif
     }
 
 method calculation[] = {
@@ -4795,6 +7387,9 @@ method calculation[] = {
     {"go",calculate}, /*Alternative to `calculate' and `run'*/
     {"trc",trc},
     {"print",print},
+    {"profile",profile},
+    {"batch",batch},
+    {"bind",bindfile},
     {"export",eksport},
     {"New",calculationnew},
     {"Die",calculationdie},
@@ -4831,3 +7426,93 @@ Bart 20010222
 
 */
 
+static fortharray* embeddedArray(const char* object, const char* array, psk* pobject)
+/* The array named <array> of the UFP object that is the value of the variable
+   named <object>. If pobject is not 0, it is set to the object node. */
+    {
+    psk name = scopy(object);
+    psk val;
+    forthMemory* mem;
+    if(name == 0)
+        return 0;
+    val = getValueByVariableName(name);
+    wipe(name);
+    if(val == 0
+       || !is_object(val)
+       || !ISCREATEDWITHNEW((objectnode*)val)
+       || ((typedObjectnode*)val)->vtab != calculation
+       )
+        return 0;
+    mem = (forthMemory*)(((typedObjectnode*)val)->voiddata);
+    if(mem == 0)
+        return 0;
+    if(pobject)
+        *pobject = val;
+    return getArrayPointer(&(mem->arr), (char*)array);
+    }
+
+typedef struct exportedArray /* handed out by ufpArray() */
+    {
+    psk object; /* a reference that keeps the UFP object alive */
+    fortharray* arr;
+    } exportedArray;
+
+void* ufpArray(const char* object, const char* array, int* elementsize, size_t* rank, size_t* shape, size_t maxrank, void** pin)
+/* For programs that embed Bracmat, such as the Python module: the elements of
+   an array of a UFP object, without copying them. Sets the size of an element
+   (8 or 4), the rank and at most maxrank extents, first index first. Returns 0
+   if there is no such array or if it has no elements yet.
+   *pin is set to a handle that must be passed to ufpReleaseArray() when the
+   elements are no longer used. Until then, the UFP object is kept alive, and
+   tbl$, bind and Die refuse to free or move the elements. */
+    {
+    psk val = 0;
+    fortharray* arr = embeddedArray(object, array, &val);
+    exportedArray* view;
+    if(arr == 0 || arr->pval == 0 || arr->size == 0)
+        return 0;
+    view = (exportedArray*)bmalloc(sizeof(exportedArray));
+    if(view == 0)
+        return 0;
+    view->object = same_as_w(val);
+    view->arr = arr;
+    ++arr->exported;
+    *pin = view;
+    *elementsize = (int)elementSize(arr);
+    *rank = arr->rank;
+    for(size_t k = 0; k < arr->rank && k < maxrank; ++k)
+        shape[k] = arr->extent[arr->rank - 1 - k];
+    return arr->pval;
+    }
+
+void ufpReleaseArray(void* pin)
+/* Ends the use of the elements that ufpArray() returned together with pin. */
+    {
+    exportedArray* view = (exportedArray*)pin;
+    --view->arr->exported;
+    wipe(view->object); /* may destroy the object */
+    bfree(view);
+    }
+
+long ufpSetArray(const char* object, const char* array, const void* data, int elementsize, size_t rank, const size_t* shape)
+/* Copies doubles (elementsize 8) or 32-bit floats (elementsize 4) into an array
+   of a UFP object that has the same rank and extents. Returns the number of
+   elements or -1. */
+    {
+    fortharray* arr = embeddedArray(object, array, 0);
+    size_t k;
+    if(arr == 0 || arr->pval == 0 || arr->size == 0 || rank != arr->rank || (elementsize != 8 && elementsize != 4))
+        return -1L;
+    for(k = 0; k < rank; ++k)
+        if(shape[k] != arr->extent[rank - 1 - k])
+            return -1L;
+    if((size_t)elementsize == elementSize(arr))
+        memcpy(arr->pval, data, arr->size * elementSize(arr));
+    else if(elementsize == 8)
+        for(k = 0; k < arr->size; ++k)
+            setElement(arr, k, ((const double*)data)[k]);
+    else
+        for(k = 0; k < arr->size; ++k)
+            setElement(arr, k, (double)((const float*)data)[k]);
+    return (long)arr->size;
+    }
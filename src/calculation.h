@@ -1,5 +1,9 @@
 #ifndef CALCULATION_H
 #define CALCULATION_H
 #include "typedobjectnode.h"
+#include <stddef.h>
 extern method calculation[];
+void* ufpArray(const char* object, const char* array, int* elementsize, size_t* rank, size_t* shape, size_t maxrank, void** pin);
+void ufpReleaseArray(void* pin);
+long ufpSetArray(const char* object, const char* array, const void* data, int elementsize, size_t rank, const size_t* shape);
 #endif
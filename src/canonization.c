@@ -83,7 +83,7 @@ psk handleExponents(psk Pnode)
         }
     else
         {
-        static const char* conc_arr[] = { NULL,NULL,NULL,NULL,NULL,NULL };
+        static THREADLOCAL const char* conc_arr[] = { NULL,NULL,NULL,NULL,NULL,NULL };
 
         Qnumber iexponent, hiexponent;
 
@@ -459,7 +459,7 @@ psk mergeOrSortTerms(psk Pnode)
 
 
     */
-    static const char* conc[] = { NULL,NULL,NULL,NULL };
+    static THREADLOCAL const char* conc[] = { NULL,NULL,NULL,NULL };
     int res = FALSE;
     psk top = Pnode;
 
@@ -857,7 +857,7 @@ psk mergeOrSortTerms(psk Pnode)
 
 psk substtimes(psk Pnode)
     {
-    static const char* conc[] = { NULL,NULL,NULL,NULL };
+    static THREADLOCAL const char* conc[] = { NULL,NULL,NULL,NULL };
     psk rkn, lkn;
     psk rvar, lvar;
     psk temp, llnode, rlnode;
@@ -1150,6 +1150,8 @@ int cmpplus(psk kn1, psk kn2)
         splitProduct_number_im_rest(kn2, &N2, &I2, &NNNI2);
         if(I1 != NULL && I2 == NULL)
             return 1; /* switch places: imaginary terms after real terms */
+        else if(I1 == NULL && I2 != NULL)
+            return -1;
         if(NNNI2 == NULL)
             {
             if(NNNI1 != NULL)
@@ -1219,6 +1221,82 @@ int cmptimes(psk kn1, psk kn2)
         }
     }
 
+/*
+Sorting of long sums and products.
+
+merge() inserts the operands one by one, from right to left, in the sorted
+remainder of the expression, walking from the front to find the right place.
+Canonizing a sum or product of n operands in random order therefore costs
+O(n^2) comparisons. If the chain has SORTEDCHAIN or more operands, merge()
+first puts the evaluated operands in order with a stable merge sort, which
+costs O(n log n) comparisons, or n - 1 if they already are in order. Then each
+operand is inserted at the front after one comparison, and only neighbours
+such as 3*a and 4*a or a^2 and a^3 remain to be combined.
+
+{?} (sum of 4060 terms like 7*x123, i*y4 and 5, in random order):?S
+    3980 ms before, 8 ms now
+*/
+#define SORTEDCHAIN 16
+
+static psk sortKey(psk operand, int op)
+    {
+    return Op(operand) == op ? operand->LEFT : operand;
+    }
+
+static void sortOperands(psk* a, psk* tmp, size_t n, int op, int(*comp)(psk, psk))
+    {
+    size_t h, i, j, k;
+    if(n < 2)
+        return;
+    h = n / 2;
+    sortOperands(a, tmp, h, op, comp);
+    sortOperands(a + h, tmp, n - h, op, comp);
+    if(comp(sortKey(a[h - 1], op), sortKey(a[h], op)) <= 0)
+        return;
+    memcpy(tmp, a, h * sizeof(psk));
+    for(i = 0, j = h, k = 0; i < h && j < n;)
+        {
+        if(comp(sortKey(tmp[i], op), sortKey(a[j], op)) <= 0)
+            a[k++] = tmp[i++];
+        else
+            a[k++] = a[j++];
+        }
+    while(i < h)
+        a[k++] = tmp[i++];
+    }
+
+/* last is the last operator of the chain, Rennur holds the other operators in
+   reverse order. All operands are evaluated. */
+static void sortChain(psk last, psk Rennur, int(*comp)(psk, psk))
+    {
+    int op = Op(last);
+    size_t n = 1, m, k;
+    psk node;
+    psk* operands;
+    for(node = Rennur; node != &nilNode; node = node->RIGHT)
+        ++n;
+    /* The right operand of the last operator is sorted along, unless it is
+       a sorted chain itself. */
+    m = Op(last->RIGHT) == op ? n : n + 1;
+    if(m < SORTEDCHAIN)
+        return;
+    operands = (psk*)bmalloc(2 * m * sizeof(psk));
+    k = n - 1;
+    operands[k] = last->LEFT;
+    for(node = Rennur; node != &nilNode; node = node->RIGHT)
+        operands[--k] = node->LEFT;
+    if(m > n)
+        operands[n] = last->RIGHT;
+    sortOperands(operands, operands + m, m, op, comp);
+    k = n - 1;
+    last->LEFT = operands[k];
+    for(node = Rennur; node != &nilNode; node = node->RIGHT)
+        node->LEFT = operands[--k];
+    if(m > n)
+        last->RIGHT = operands[n];
+    bfree(operands);
+    }
+
 psk merge(psk Pnode
           , int(*comp)(psk, psk)
           , psk(*combine)(psk)
@@ -1277,6 +1355,7 @@ psk merge(psk Pnode
         Rennur = Pnode;
         Pnode = tmp;
         }
+    sortChain(Pnode, Rennur, comp);
     for(;;)
         { /* From right to left, prepend sorted elements to result */
         psk rennur = &nilNode; /*Will contain branches in inverse sorted order*/
@@ -1407,7 +1486,7 @@ psk merge(psk Pnode
 
 psk substlog(psk Pnode)
     {
-    static const char* conc[] = { NULL,NULL,NULL,NULL };
+    static THREADLOCAL const char* conc[] = { NULL,NULL,NULL,NULL };
     psk lnode = Pnode->LEFT, rightnode = Pnode->RIGHT;
     if(!equal(lnode, rightnode))
         {
@@ -1565,7 +1644,7 @@ psk substdiff(psk Pnode)
 #include <dde.h>
 static void PeekMsg(void)
     {
-    static MSG msg;
+    static THREADLOCAL MSG msg;
     while(PeekMessage(&msg, NULL, WM_PAINT, WM_DDE_LAST, PM_REMOVE))
         {
         if(msg.message == WM_QUIT)
@@ -1586,7 +1665,7 @@ Can now handle very deep structures without stack overflow
 
 psk handleWhitespace(psk Pnode)
     { /* assumption: (Op(*Pnode) == WHITE) && !((*Pnode)->v.fl & READY) */
-    static psk apnode;
+    static THREADLOCAL psk apnode;
     psk whitespacenode;
     psk next;
     ppsk pwhitespacenode = &Pnode;
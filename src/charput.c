@@ -20,9 +20,9 @@
 #include <assert.h>
 
 
-inputBuffer* InputArray;
-unsigned char* inputBufferPointer;
-unsigned char* maxInputBufferPointer; /* inputBufferPointer <= maxInputBufferPointer,
+THREADLOCAL inputBuffer* InputArray;
+THREADLOCAL unsigned char* inputBufferPointer;
+THREADLOCAL unsigned char* maxInputBufferPointer; /* inputBufferPointer <= maxInputBufferPointer,
                             if inputBufferPointer == maxInputBufferPointer, don't assign to *inputBufferPointer */
 
 void lput(int c)
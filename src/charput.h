@@ -1,6 +1,8 @@
 #ifndef CHARPUT_H
 #define CHARPUT_H
 
+#include "platformdependentdefs.h"
+
 #ifdef __SYMBIAN32__
 /* #define DEFAULT_INPUT_BUFFER_SIZE 0x100*/ /* If too high you get __chkstk error. Stack = 8K only! */
 /* #define DEFAULT_INPUT_BUFFER_SIZE 0x7F00*/
@@ -29,9 +31,9 @@ typedef struct inputBuffer
     unsigned int mallocallocated : 8; /* True if allocated with malloc. Otherwise on stack (except EPOC). */
     } inputBuffer;
 
-extern inputBuffer* InputArray;
-extern unsigned char* inputBufferPointer;
-extern unsigned char* maxInputBufferPointer; /* inputBufferPointer <= maxInputBufferPointer,
+extern THREADLOCAL inputBuffer* InputArray;
+extern THREADLOCAL unsigned char* inputBufferPointer;
+extern THREADLOCAL unsigned char* maxInputBufferPointer; /* inputBufferPointer <= maxInputBufferPointer,
                             if inputBufferPointer == maxInputBufferPointer, don't assign to *inputBufferPointer */
 
 void lput(int c);
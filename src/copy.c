@@ -3,7 +3,11 @@
 #include "memory.h"
 #include "objectnode.h"
 #include "numbercheck.h"
+#include "nonnodetypes.h"
+#include "wipecopy.h"
 #include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
 #include <assert.h>
 
 
@@ -71,6 +75,151 @@ psk scopy(const char* str)
 
 psk subtreecopy(psk src);
 
+/* Atoms without prefixes and with no more than INTERNMAXLENGTH bytes that are
+   read by the parser, e.g. element names and words in XML data, are interned:
+   an atom that is equal to an atom in the intern table is replaced by a
+   reference to the latter. The table owns one reference to each atom in it, so
+   an interned atom is always shared and is never changed in place. (Neither
+   oncePattern() nor stringOncePattern() sets IMPLIEDFENCE on a nonempty atom
+   without prefixes.) Atoms that are only referenced by the table are released
+   when the table would have to grow and when bez$ is called. */
+#define INTERNMAXLENGTH 32
+#define INTERNMINSIZE 1024 /* must be a power of 2 */
+
+typedef struct internslot
+    {
+    ULONG hash;
+    psk atom; /* NULL if slot is empty */
+    } internslot;
+
+static THREADLOCAL internslot* interned = NULL;
+static THREADLOCAL size_t internedSize = 0;
+static THREADLOCAL size_t internedCount = 0;
+/* Counters, reported by mem$STA */
+static THREADLOCAL ULONG internLookups = 0;
+static THREADLOCAL ULONG internHits = 0;
+
+static void putInterned(internslot* slots, size_t size, ULONG hash, psk atom)
+    {
+    size_t mask = size - 1;
+    size_t i;
+    for(i = (size_t)hash & mask; slots[i].atom; i = (i + 1) & mask)
+        ;
+    slots[i].hash = hash;
+    slots[i].atom = atom;
+    }
+
+/* Releases atoms that only are referenced by the table. Doubles the size of
+   the table if it still is more than a quarter full. */
+static int rebuildInterned(void)
+    {
+    internslot* slot;
+    internslot* newinterned;
+    size_t newSize = internedSize;
+    size_t count = 0;
+    for(slot = interned; slot < interned + internedSize; ++slot)
+        {
+        if(slot->atom)
+            {
+            if(!shared(slot->atom))
+                {
+                pskfree(slot->atom);
+                slot->atom = NULL;
+                }
+            else
+                ++count;
+            }
+        }
+    internedCount = count;
+    if(4 * count > newSize)
+        newSize <<= 1;
+    newinterned = (internslot*)calloc(newSize, sizeof(internslot));
+    if(!newinterned)
+        return FALSE;
+    for(slot = interned; slot < interned + internedSize; ++slot)
+        if(slot->atom)
+            putInterned(newinterned, newSize, slot->hash, slot->atom);
+    free(interned);
+    interned = newinterned;
+    internedSize = newSize;
+    return TRUE;
+    }
+
+void releaseInternedAtoms(void)
+    {
+    if(interned)
+        rebuildInterned();
+    }
+
+/* Returns statistics for mem$STA: the number of interned atoms, the size of
+   the intern table, the number of lookups and the number of lookups that found
+   an atom. */
+const char* internStatistics(void)
+    {
+    static THREADLOCAL char draft[128];
+    sprintf(draft
+            , " (atoms." LONGU ") (atomslots." LONGU ") (atomlookups." LONGU ") (atomhits." LONGU ")"
+            , (ULONG)internedCount
+            , (ULONG)internedSize
+            , internLookups
+            , internHits
+    );
+    return draft;
+    }
+
+/* Takes ownership of pnode. Returns either pnode or an equal interned atom. */
+psk internedAtom(psk pnode)
+    {
+    /* FNV-1a */
+    ULONG hash = 2166136261UL;
+    const unsigned char* strng = POBJ(pnode);
+    size_t mask, i;
+    if(!*strng)
+        return pnode;
+#if EVALUATIONARENA
+    if(inArena(pnode)) /* would keep the arena alive */
+        return pnode;
+#endif
+    for(; *strng; ++strng)
+        {
+        if(strng - POBJ(pnode) == INTERNMAXLENGTH)
+            return pnode;
+        hash ^= *strng;
+        hash *= 16777619UL;
+        }
+    if(!interned)
+        {
+        interned = (internslot*)calloc(INTERNMINSIZE, sizeof(internslot));
+        if(!interned)
+            return pnode;
+        internedSize = INTERNMINSIZE;
+        }
+    ++internLookups;
+    mask = internedSize - 1;
+    for(i = (size_t)hash & mask; interned[i].atom; i = (i + 1) & mask)
+        {
+        psk atom = interned[i].atom;
+        if(interned[i].hash == hash
+           && (atom->v.fl & COPYFILTER) == (pnode->v.fl & COPYFILTER)
+           && !strcmp((char*)POBJ(atom), (char*)POBJ(pnode))
+           )
+            {
+            if(shared(atom) == ALL_REFCOUNT_BITS_SET)
+                return pnode;
+            ++internHits;
+            atom->v.fl += ONEREF;
+            pskfree(pnode);
+            return atom;
+            }
+        }
+    if(2 * (internedCount + 1) > internedSize && !rebuildInterned())
+        return pnode;
+    pnode->v.fl += ONEREF;
+    putInterned(interned, internedSize, hash, pnode);
+    ++internedCount;
+    return pnode;
+    }
+
 psk same_as_w(psk pnode)
     {
     if(shared(pnode) != ALL_REFCOUNT_BITS_SET)
@@ -136,6 +285,29 @@ psk subtreecopy(psk src)
         return iCopyOf(src);
     }
 
+#if EVALUATIONARENA
+/* Return a copy of the tree, with nodes that reside in the arena replaced by
+   copies in the pools. Objects and late bound nodes are not copied.
+   Must be called while the arena is inactive. */
+psk promoted(psk pnode)
+    {
+    psk ret;
+    if(!inArena(pnode) || is_object(pnode) || (pnode->v.fl & LATEBIND))
+        return pnode;
+    if(is_op(pnode))
+        {
+        ret = new_operator_like(pnode);
+        ret->v.fl = pnode->v.fl & COPYFILTER;
+        ret->LEFT = promoted(same_as_w(pnode->LEFT));
+        ret->RIGHT = promoted(same_as_w(pnode->RIGHT));
+        }
+    else
+        ret = iCopyOf(pnode);
+    wipe(pnode);
+    return ret;
+    }
+#endif
+
 psk isolated(psk Pnode)
     {
     if(shared(Pnode))
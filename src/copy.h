@@ -17,7 +17,13 @@ psk setflgs(psk pokn, ULONG Flgs);
 void icpy(LONG* d, LONG* b, int words);
 #endif
 psk copyop(psk Pnode);
+#if EVALUATIONARENA
+psk promoted(psk pnode);
+#endif
 psk charcopy(const char* strt, const char* until);
+psk internedAtom(psk pnode);
+void releaseInternedAtoms(void);
+const char* internStatistics(void);
 
 
 #endif
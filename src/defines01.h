@@ -15,6 +15,35 @@
                              (include xml.c in your project!) */
 #define READJSON 1 /* Read JSON files. (Include json.c in your project!) */
 #define SHOWMEMBLOCKS 0
+#ifndef EVALUATIONARENA /* can be set in Makefile */
+#define EVALUATIONARENA 0 /* 1: During stringEval(), take small blocks from a
+                             region that is reused as a whole when none of its
+                             blocks is in use anymore. See memory.c. */
+#endif
+#ifndef PREPAREDPATTERNS /* can be set in Makefile */
+#define PREPAREDPATTERNS 1 /* 1: Remember patterns !var that are ready for tree
+                              matching, instead of preparing them again each
+                              time they are used. 0: the old behaviour, to
+                              compare results. See treematch.c. */
+#endif
+#ifndef DIRECTTHREADING /* can be set in Makefile */
+#define DIRECTTHREADING 1 /* 1: If compiled with GCC or clang, UFP code jumps
+                             from word to word through the addresses of labels
+                             instead of through a switch statement. 0: always
+                             the switch statement. See calculation.c. */
+#endif
+#ifndef JITCOMPILE /* can be set in Makefile */
+#define JITCOMPILE 1 /* 1: On x86-64 Linux, BSD or macOS, UFP code is
+                        translated to machine code when the calculation object
+                        is created. 0: UFP code is always interpreted. See
+                        calculation.c. */
+#endif
+#ifndef CALCULATION_THREADS /* can be set in Makefile */
+#define CALCULATION_THREADS 16 /* The largest number of POSIX threads among
+                                  which the batch method of a UFP object
+                                  divides its work. 1: no threads. See
+                                  calculation.c. */
+#endif
 #define DATAMATCHESITSELF 0 /* An experiment from August 2021.
 The idea is to make matching a data structure with itself faster by just
 checking whether they have the same address. Only structures with no prefixes
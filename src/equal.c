@@ -191,7 +191,11 @@ int compare(psk s, psk p)
             int R = !ee && (Njet ^ ul ^ !TMP);
             return R;
             }
-        if((p->v.fl & (/*NOT |*/ FRACTION | NUMBER | GREATER_THAN | SMALLER_THAN)) == (/*NOT |*/ GREATER_THAN | SMALLER_THAN))
+        if(s == p) /* Shared node, e.g. an interned atom. */
+            {
+            Sign = 0;
+            }
+        else if((p->v.fl & (/*NOT |*/ FRACTION | NUMBER | GREATER_THAN | SMALLER_THAN)) == (/*NOT |*/ GREATER_THAN | SMALLER_THAN))
             { /* Case insensitive match: ~<> means "not different", <> means "different, even if case differences don't count" */
             Sign = strcasecomp((char*)POBJ(s), (char*)POBJ(p));
             }
@@ -223,6 +227,33 @@ int compare(psk s, psk p)
         }
     }
 
+#if CUTOFFSUGGEST
+/*
+Returns the first position after s where a match with the case insensitive
+pattern P can start, or the end of the string if there is no such position.
+If P starts with an ASCII character, a candidate position has the same
+character in lower or upper case, or a non-ASCII byte, which may start a
+character such as the Kelvin sign that becomes ASCII in lower case.
+*/
+static char* nextCaseInsensitiveStart(char* s, const char* P)
+    {
+    unsigned char lc = (unsigned char)*P;
+    unsigned char uc = lc;
+    if(lc & 0x80)
+        return s + 1;
+    if('A' <= lc && lc <= 'Z')
+        lc += 'a' - 'A';
+    else if('a' <= uc && uc <= 'z')
+        uc -= 'a' - 'A';
+    while(*++s)
+        {
+        unsigned char b = (unsigned char)*s;
+        if(b == lc || b == uc || (b & 0x80))
+            break;
+        }
+    return s;
+    }
+#endif
 
 /*
 With the % flag on an otherwise numeric pattern, the pattern is treated
@@ -548,7 +579,20 @@ int scompare(char* s, char* cutoff, psk p
 
     if((Flgs & (NOT | FRACTION | NUMBER | GREATER_THAN | SMALLER_THAN)) == (NOT | GREATER_THAN | SMALLER_THAN))
         { /* Case insensitive match: ~<> means "not different, <> means "different, even if case differences don't count"" */
+#if CUTOFFSUGGEST
+        int Ret = strcasecompu(s, P, cutoff); /* Additional argument cutoff */
+        if(Ret == ONCE
+           && !(Flgs & MINUS)
+           && mayMoveStartOfSubject
+           && *mayMoveStartOfSubject != 0
+           )
+            {
+            *mayMoveStartOfSubject = nextCaseInsensitiveStart(S, P);
+            }
+        return Ret;
+#else
         return strcasecompu(s, P, cutoff); /* Additional argument cutoff */
+#endif
         }
     else if((Flgs & (/*NOT |*/ FRACTION | NUMBER | GREATER_THAN | SMALLER_THAN)) == (/*NOT |*/ GREATER_THAN | SMALLER_THAN))
         { /* Case insensitive match: ~<> means "not different, <> means "different, even if case differences don't count"" */
@@ -647,6 +691,8 @@ int scompare(char* s, char* cutoff, psk p
                             if(Flgs & MINUS)
                                 --startpos;
                             }
+                        else if(*S && !RATIONAL_WEAK(p)) /* No later start can match either. */
+                            startpos = S + strlen(S);
                         /*assert(  startpos == 0
                               || (startpos+strlen((char *)POBJ(p)) < cutoff - 1)
                               || (startpos+strlen((char *)POBJ(p)) >= cutoff)
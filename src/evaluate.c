@@ -19,8 +19,8 @@
 #include <string.h>
 
 #if MAXSTACK
-static int maxstack = 0;
-static int theStack = 0;
+static THREADLOCAL int maxstack = 0;
+static THREADLOCAL int theStack = 0;
 #define ASTACK {++theStack;if(theStack > maxstack) maxstack = theStack;}{
 #define ZSTACK }{--theStack;}
 #else
@@ -170,8 +170,7 @@ psk eval(psk Pnode)
                            && !(Pnode->v.fl & DOUBLY_INDIRECT)
                            )
                             {
-                            static int fl;
-                            fl = Pnode->v.fl & (UNOPS & ~INDIRECT);
+                            int fl = Pnode->v.fl & (UNOPS & ~INDIRECT);
                             Pnode = __rightbranch(Pnode);
                             if(fl)
                                 {
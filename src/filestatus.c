@@ -40,7 +40,7 @@ typedef struct fileStatus
 #endif
     } fileStatus;
 
-static fileStatus* fs0 = NULL;
+static THREADLOCAL fileStatus* fs0 = NULL;
 #endif
 
 #if !defined NO_FOPEN
@@ -183,7 +183,7 @@ static LONG someopt(psk pnode, LONG opt[])
 
 #if !defined NO_FOPEN
 
-static LONG tijdnr = 0L;
+static THREADLOCAL LONG tijdnr = 0L;
 
 static int closeAFile(void)
     {
@@ -280,7 +280,7 @@ int fil(ppsk PPnode)
     LONG ind;
     int sh;
     psk pnode;
-    static fileStatus* fs = NULL;
+    static THREADLOCAL fileStatus* fs = NULL;
     char* name;
 
     static LONG types[] = { CHR,DEC,STRt,0L };
@@ -303,7 +303,7 @@ int fil(ppsk PPnode)
     O('a','b','+'),/*append;open binary file or create for update, writing at eof*/
     0L };
 
-    static LONG type, numericalvalue, whence;
+    static THREADLOCAL LONG type, numericalvalue, whence;
     union
         {
         LONG l;
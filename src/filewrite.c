@@ -17,12 +17,12 @@ link with -DREADLINE -lreadline
 #endif
 
 #if _BRACMATEMBEDDED
-static int(*WinIn)(void) = NULL;
-static void(*WinOut)(int c) = NULL;
-static void(*WinFlush)(void) = NULL;
+static THREADLOCAL int(*WinIn)(void) = NULL;
+static THREADLOCAL void(*WinOut)(int c) = NULL;
+static THREADLOCAL void(*WinFlush)(void) = NULL;
 #if defined PYTHONINTERFACE
-static void(*Ni)(const char*) = NULL;
-static const char* (*Nii)(const char*) = NULL;
+static THREADLOCAL void(*Ni)(const char*) = NULL;
+static THREADLOCAL const char* (*Nii)(const char*) = NULL;
 #endif
 int mygetc(FILE* fpi)
     {
@@ -55,7 +55,7 @@ void myputc(int c)
     }
 
 #if defined __GNUC__ && defined READLINE
-char prompt[256] = { 0 };
+THREADLOCAL char prompt[256] = { 0 };
 #endif
 
 int mygetc(FILE* fpi)
@@ -99,8 +99,8 @@ int mygetc(FILE* fpi)
 #if defined __GNUC__ && defined READLINE
     if(fpi == stdin)
         {
-        static unsigned char* inputbuffer = 0;
-        static unsigned char* out = 0;
+        static THREADLOCAL unsigned char* inputbuffer = 0;
+        static THREADLOCAL unsigned char* out = 0;
         if(!out)
             {
             char* line = readline(prompt);
@@ -129,7 +129,7 @@ int mygetc(FILE* fpi)
     }
 #endif
 
-void(*process)(int c) = myputc;
+THREADLOCAL void(*process)(int c) = myputc;
 
 void myprintf(const char* strng, ...)
     {
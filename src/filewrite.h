@@ -19,10 +19,10 @@ void myputc(int c);
 int mygetc(FILE* fpi);
 #endif
 
-extern void(*process)(int c);
+extern THREADLOCAL void(*process)(int c);
 
 #if defined __GNUC__ && defined READLINE
-extern char prompt[256];
+extern THREADLOCAL char prompt[256];
 #endif
 
 void myprintf(const char* strng, ...);
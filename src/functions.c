@@ -24,6 +24,7 @@
 #include "objectdef.h"
 #include "objectnode.h"
 #include "macro.h"
+#include "treematch.h"
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
@@ -180,7 +181,7 @@ static char* postUrl(const char* url, const char* body, struct curl_slist* heade
 #endif
 
 #ifdef DELAY_DUE_TO_INPUT
-static clock_t delayDueToInput = 0;
+static THREADLOCAL clock_t delayDueToInput = 0;
 #endif
 
 #if !defined NO_C_INTERFACE
@@ -826,7 +827,7 @@ static void SortMOP(psk fun, psk datanode, ULONG inop, psk outopnode, ULONG fl,
 
 function_return_type functions(psk Pnode)
     {
-    static char draft[112];
+    static THREADLOCAL char draft[112];
     psk lnode, rnode, rlnode, rrnode;
     union
         {
@@ -1257,6 +1258,11 @@ function_return_type functions(psk Pnode)
 #if SHOWMAXALLOCATED
         CASE(BEZ) /* bez $  */
             {
+            releaseInternedAtoms(); /* not in use, but still allocated */
+            releaseBinaryNumbers();
+#if PREPAREDPATTERNS
+            releasePreparedPatterns();
+#endif
             Bez(draft);
             Pnode = build_up(Pnode, draft, NULL);
 #if SHOWCURRENTLYALLOCATED
@@ -1784,7 +1790,7 @@ function_return_type functions(psk Pnode)
 #endif
         CASE(ARG) /* arg$ or arg$N  (N == 0,1,... and N < argc) */
             {
-            static int argno = 0;
+            static THREADLOCAL int argno = 0;
             if(is_op(rnode))
                 return functionFail(Pnode);
             if(PLOBJ(rnode) != '\0')
@@ -2124,16 +2130,44 @@ function_return_type functions(psk Pnode)
             return functionOk(Pnode);
             }
 
-        CASE(SIM) /* sim$(<atom>,<atom>) , fuzzy compare (percentage) */
+        CASE(SIM) /* sim$(<atom>,<atom>) , fuzzy compare (percentage) 
+                     sim$(<atom>,<atom> <atom> ...) , idem, list of results */
             {
             if(is_op(rnode)
-               && !is_op(rlnode = rnode->LEFT)
-               && !is_op(rrnode = rnode->RIGHT))
+               && !is_op(rlnode = rnode->LEFT))
                 {
-                Sim(draft, (char*)POBJ(rlnode), (char*)POBJ(rrnode));
-                wipe(Pnode);
-                Pnode = scopy((const char*)draft);
-                return functionOk(Pnode);
+                rrnode = rnode->RIGHT;
+                if(!is_op(rrnode))
+                    {
+                    Sim(draft, (char*)POBJ(rlnode), (char*)POBJ(rrnode));
+                    wipe(Pnode);
+                    Pnode = scopy((const char*)draft);
+                    return functionOk(Pnode);
+                    }
+                else
+                    {
+                    psk lst;
+                    ppsk plst = &lst;
+                    for(; Op(rrnode) == WHITE; rrnode = rrnode->RIGHT)
+                        if(is_op(rrnode->LEFT))
+                            return functionFail(Pnode);
+                    if(is_op(rrnode))
+                        return functionFail(Pnode);
+                    for(rrnode = rnode->RIGHT; Op(rrnode) == WHITE; rrnode = rrnode->RIGHT)
+                        {
+                        psk nnode = (psk)bmalloc(sizeof(knode));
+                        nnode->v.fl = WHITE | SUCCESS;
+                        Sim(draft, (char*)POBJ(rlnode), (char*)POBJ(rrnode->LEFT));
+                        nnode->LEFT = scopy((const char*)draft);
+                        *plst = nnode;
+                        plst = &(nnode->RIGHT);
+                        }
+                    Sim(draft, (char*)POBJ(rlnode), (char*)POBJ(rrnode));
+                    *plst = scopy((const char*)draft);
+                    wipe(Pnode);
+                    Pnode = lst;
+                    return functionOk(Pnode);
+                    }
                 }
             else
                 return functionFail(Pnode);
@@ -5,10 +5,10 @@
 #include <stdarg.h>
 
 #if DEBUGBRACMAT
-int debug = 0;
+THREADLOCAL int debug = 0;
 #endif
 #if CHECKALLOCBOUNDS
-int POINT = 0;
+THREADLOCAL int POINT = 0;
 #endif
 
 #if CODEPAGE850
@@ -53,45 +53,45 @@ const unsigned char upperEquivalent[256] =
     };
 #endif
 
-int dummy_op = WHITE;
-psk addr[7];
-sk zeroNode, oneNode, minusOneNode,
+THREADLOCAL int dummy_op = WHITE;
+THREADLOCAL psk addr[7];
+THREADLOCAL sk zeroNode, oneNode, minusOneNode,
 nilNode, nilNodeNotNeutral,
 zeroNodeNotNeutral,
 oneNodeNotNeutral,
 argNode, selfNode, SelfNode, twoNode, fourNode, sjtNode;
 
-FILE* global_fpi;
-FILE* global_fpo;
-int optab[256];
+THREADLOCAL FILE* global_fpi;
+THREADLOCAL FILE* global_fpo;
+THREADLOCAL int optab[256];
 
 #if GLOBALARGPTR
-va_list argptr;
+THREADLOCAL va_list argptr;
 #endif
 
 #if !defined NO_FOPEN
-char* errorFileName = NULL;
+THREADLOCAL char* errorFileName = NULL;
 #endif
-FILE* errorStream = NULL;
+THREADLOCAL FILE* errorStream = NULL;
 
-int hum = 1;
-int listWithName = 1;
-Boolean beNice = TRUE;
-psk global_anchor;
-size_t telling = 0;
-unsigned char* source;
+THREADLOCAL int hum = 1;
+THREADLOCAL int listWithName = 1;
+THREADLOCAL Boolean beNice = TRUE;
+THREADLOCAL psk global_anchor;
+THREADLOCAL size_t telling = 0;
+THREADLOCAL unsigned char* source;
 
-const psk knil[16] =
-    { NULL,NULL,NULL,NULL,NULL,NULL,&nilNode,&zeroNode,
-    &oneNode,NULL,NULL,NULL,NULL,NULL,NULL,NULL };
+THREADLOCAL psk knil[16] =
+    { NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,
+    NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL };
 
 #if !defined NO_FOPEN
-char* targetPath = NULL; /* Path that can be prepended to filenames. */
+THREADLOCAL char* targetPath = NULL; /* Path that can be prepended to filenames. */
 #endif
 
-int ARGC = 0;
-char** ARGV = NULL;
+THREADLOCAL int ARGC = 0;
+THREADLOCAL char** ARGV = NULL;
 
-psk m0 = NULL, m1 = NULL, f0 = NULL, f1 = NULL, f4 = NULL, f5 = NULL;
+THREADLOCAL psk m0 = NULL, m1 = NULL, f0 = NULL, f1 = NULL, f4 = NULL, f5 = NULL;
 
 
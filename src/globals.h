@@ -8,57 +8,57 @@
 #include <stdarg.h>
 
 #if DEBUGBRACMAT
-extern int debug;
+extern THREADLOCAL int debug;
 #endif
 #if CHECKALLOCBOUNDS
-extern int POINT;
+extern THREADLOCAL int POINT;
 #endif
 #if CODEPAGE850
 extern const unsigned char lowerEquivalent[256];
 extern const unsigned char upperEquivalent[256];
 #endif
 
-extern int dummy_op;
-extern psk addr[7];
-extern sk zeroNode, oneNode, minusOneNode,
+extern THREADLOCAL int dummy_op;
+extern THREADLOCAL psk addr[7];
+extern THREADLOCAL sk zeroNode, oneNode, minusOneNode,
 nilNode, nilNodeNotNeutral,
 zeroNodeNotNeutral,
 oneNodeNotNeutral,
 argNode, selfNode, SelfNode, twoNode, fourNode, sjtNode;
 
-extern psk global_anchor;
+extern THREADLOCAL psk global_anchor;
 
 
-extern FILE* global_fpi;
-extern FILE* global_fpo;
-extern size_t telling;
+extern THREADLOCAL FILE* global_fpi;
+extern THREADLOCAL FILE* global_fpo;
+extern THREADLOCAL size_t telling;
 
 #if GLOBALARGPTR
-extern va_list argptr;
+extern THREADLOCAL va_list argptr;
 #endif
 
 #if !defined NO_FOPEN
-extern char* errorFileName;
+extern THREADLOCAL char* errorFileName;
 #endif
-extern FILE* errorStream;
-extern int optab[256];
+extern THREADLOCAL FILE* errorStream;
+extern THREADLOCAL int optab[256];
 
-extern int hum;
-extern int listWithName;
-extern Boolean beNice;
+extern THREADLOCAL int hum;
+extern THREADLOCAL int listWithName;
+extern THREADLOCAL Boolean beNice;
 
-extern unsigned char* source;
-extern const psk knil[16];
+extern THREADLOCAL unsigned char* source;
+extern THREADLOCAL psk knil[16]; /* neutral elements of WHITE, PLUS and TIMES, set by startProc */
 
 #if !defined NO_FOPEN
-extern char* targetPath; /* Path that can be prepended to filenames. */
+extern THREADLOCAL char* targetPath; /* Path that can be prepended to filenames. */
 #endif
 
-extern int ARGC;
-extern char** ARGV;
+extern THREADLOCAL int ARGC;
+extern THREADLOCAL char** ARGV;
 
-extern psk m0, m1, f0, f1, f4, f5;
+extern THREADLOCAL psk m0, m1, f0, f1, f4, f5;
 
-extern int LineLength;
+extern THREADLOCAL int LineLength;
 
 #endif
@@ -16,6 +16,7 @@
 #include "json.h"
 #include "nodeutil.h"
 #include "writeerr.h"
+#include "variables.h"
 #include <stdarg.h>
 #include <string.h>
 #include <assert.h>
@@ -36,13 +37,13 @@
 #endif
 
 
-static unsigned char* startPos;
-static unsigned char* start;
-static unsigned char** pstart;
+static THREADLOCAL unsigned char* startPos;
+static THREADLOCAL unsigned char* start;
+static THREADLOCAL unsigned char** pstart;
 
 static const char unbalanced[] = "unbalanced";
 
-static inputBuffer* InputElement; /* Points to member of InputArray */
+static THREADLOCAL inputBuffer* InputElement; /* Points to member of InputArray */
 
 
 static unsigned char* shift_nw(VOIDORARGPTR)
@@ -147,7 +148,7 @@ static unsigned char* vshift_nw(VOIDORARGPTR)
     return start;
     }
 
-static unsigned char* (*shift)(VOIDORARGPTR) = shift_nw;
+static THREADLOCAL unsigned char* (*shift)(VOIDORARGPTR) = shift_nw;
 
 void tel(int c)
     {
@@ -157,7 +158,7 @@ void tel(int c)
 
 void tstr(int c)
     {
-    static int esc = FALSE, str = FALSE;
+    static THREADLOCAL int esc = FALSE, str = FALSE;
     if(esc)
         {
         esc = FALSE;
@@ -180,7 +181,7 @@ void tstr(int c)
 
 void pstr(int c)
     {
-    static int esc = FALSE, str = FALSE;
+    static THREADLOCAL int esc = FALSE, str = FALSE;
     if(esc)
         {
         esc = FALSE;
@@ -337,6 +338,8 @@ static psk Atom(int Flgs)
         Pnode->v.fl |= SELFMATCHING;
         }
 #endif
+    if(!(Pnode->v.fl & VISIBLE_FLAGS))
+        Pnode = internedAtom(Pnode);
     return Pnode;
     }
 
@@ -469,6 +472,8 @@ static psk lex(unsigned int* nxt, int priority, int Flags, va_list* pargptr)
                         Flags ^= SUCCESS;
                         }
 #endif
+                    if(Flags && !is_op(Pnode))
+                        Pnode = isolated(Pnode); /* may be interned */
                     Pnode->v.fl ^= Flags; /*19970821*/
                     if(nxt)
                         *nxt = op_or_0; /* Tell the ancestors of Pnode about
@@ -567,6 +572,8 @@ static psk lex(unsigned int* nxt, int priority, int Flags, va_list* pargptr)
                 }
             while(op_or_0 != 0);
             }
+        if(Flags && !is_op(Pnode))
+            Pnode = isolated(Pnode); /* may be interned */
         Pnode->v.fl ^= Flags; /*19970821*/
 #if DATAMATCHESITSELF
         Pnode = leftDescend_rightDescend(Pnode);
@@ -592,7 +599,10 @@ static psk buildtree_w(psk Pnode)
     Pnode = lex(NULL, 0, 0, 0);
 #endif
     shift = shift_nw;
-    if((--InputElement)->mallocallocated)
+    /* After malformed input, lex() returns before the last vshift_w(). */
+    if(InputElement > InputArray)
+        --InputElement;
+    if(InputElement->mallocallocated)
         {
         bfree(InputElement->buffer);
         }
@@ -630,7 +640,7 @@ static void politelyWriteError(psk Pnode)
 
 psk input(FILE* fpi, psk Pnode, int echmemvapstrmltrmtxt, Boolean* err, Boolean* GoOn)
     {
-    static int stdinEOF = FALSE;
+    static THREADLOCAL int stdinEOF = FALSE;
     int braces, ikar, hasop, whiteSpaceSeen, escape, backslashesAreEscaped,
         inString, parentheses, error;
 #ifdef __SYMBIAN32__
@@ -1088,7 +1098,7 @@ psk input(FILE* fpi, psk Pnode, int echmemvapstrmltrmtxt, Boolean* err, Boolean*
 
 #if JMP
 #include <setjmp.h>
-static jmp_buf jumper;
+static THREADLOCAL jmp_buf jumper;
 #endif
 
 void stringEval(const char* s, const char** out, int* err)
@@ -1105,9 +1115,20 @@ void stringEval(const char* s, const char** out, int* err)
         sprintf(buf, "str$(%s)", s);
 #endif
         source = (unsigned char*)buf;
+#if EVALUATIONARENA
+        beginArena();
+#endif
         global_anchor = input(NULL, global_anchor, OPT_MEM, err, NULL); /* 4 -> OPT_MEM*/
+#if EVALUATIONARENA
         if(err && *err)
+            {
+            endArena();
             return;
+            }
+#else
+        if(err && *err)
+            return;
+#endif
 #if JMP
         if(setjmp(jumper) != 0)
             {
@@ -1116,6 +1137,14 @@ void stringEval(const char* s, const char** out, int* err)
             }
 #endif
         global_anchor = eval(global_anchor);
+#if EVALUATIONARENA
+        if(endArena())
+            {
+            global_anchor = promoted(global_anchor);
+            if(arenaHalfFull())
+                promoteVariables();
+            }
+#endif
         if(out != NULL)
             *out = is_op(global_anchor) ? (const char*)"" : (const char*)POBJ(global_anchor);
         free(buf);
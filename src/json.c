@@ -48,8 +48,8 @@ typedef enum {nojson,json} jstate;
 
 #define BUFSIZE 35000
 
-static int decimals;
-static int leadingzeros;
+static THREADLOCAL int decimals;
+static THREADLOCAL int leadingzeros;
 
 static void startString(void)
     {
@@ -110,10 +110,10 @@ static void endObject(void)/* called when } has been read */
     }
 
 typedef jstate (*stateFncTp)(int);
-static unsigned int stacksiz;
-static stateFncTp * theStack;
-static stateFncTp * stackpointer;
-static stateFncTp action;
+static THREADLOCAL unsigned int stacksiz;
+static THREADLOCAL stateFncTp * theStack;
+static THREADLOCAL stateFncTp * stackpointer;
+static THREADLOCAL stateFncTp action;
 
 static stateFncTp push(stateFncTp arg)
     {
@@ -147,8 +147,8 @@ static stateFncTp popj(void)
     return *stackpointer;
     }
 
-static int needed;
-static unsigned LONG hexvalue;
+static THREADLOCAL int needed;
+static THREADLOCAL unsigned LONG hexvalue;
 
 static jstate hexdigits(int arg)
     {
@@ -334,7 +334,7 @@ static jstate valueOrCloseSquareBracket(int arg)
         }
     }
 
-static const char * FIXED;
+static THREADLOCAL const char * FIXED;
 
 static jstate fixed(int arg)
     {
@@ -352,8 +352,8 @@ static jstate fixed(int arg)
     return nojson;
     }
 
-static int signj;
-static int Nexp;
+static THREADLOCAL int signj;
+static THREADLOCAL int Nexp;
 
 static void aftermath(int zeros)
     {
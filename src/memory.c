@@ -9,6 +9,7 @@
 #include "nodestruct.h"
 #include "eval.h"
 #include "wipecopy.h"
+#include "treematch.h"
 #include <stddef.h>
 #include <assert.h>
 #include <string.h>
@@ -51,13 +52,25 @@ total bytes = 1166400
 #define MEM6SIZE 64
 #endif
 
+/*
+Blocks of up to MAXPOOLWORDS words can be taken from pools. Pools for the sizes
+listed above exist from the start. A pool for another size is made as soon as
+blocks of that size have been requested POOLTHRESHOLD times. The first block of
+elements of a new pool has room for NEWPOOLSIZE elements. Each following block
+is as big as all earlier blocks of the same size together (so the capacity
+doubles), but not bigger than MAXBLOCKBYTES.
+*/
+#define MAXPOOLWORDS 16
+#define POOLTHRESHOLD 4096
+#define NEWPOOLSIZE 1024
+#define MAXBLOCKBYTES 0x800000
 
 #if SHOWMAXALLOCATED
-static size_t globalloc = 0, maxgloballoc = 0;
+static THREADLOCAL size_t globalloc = 0, maxgloballoc = 0;
 #endif
 
 #if SHOWCURRENTLYALLOCATED
-static size_t cnts[256], alloc_cnt = 0, totcnt = 0;
+static THREADLOCAL size_t cnts[256], alloc_cnt = 0, totcnt = 0;
 #endif
 
 struct memblock
@@ -77,12 +90,16 @@ struct memblock
 struct allocation
     {
     size_t elementSize;
-    int numberOfElements;
-    struct memblock* memoryBlock;
+    int numberOfElements; /* size of next block */
+    struct memblock* memoryBlock; /* NULL if there is no pool for this size */
+    size_t capacity; /* number of elements in all blocks */
+    size_t inUse;
+    size_t maxInUse;
+    ULONG requests; /* also counts requests served by malloc */
     };
 
-static struct allocation* global_allocations;
-static int global_nallocations = 0;
+static THREADLOCAL struct allocation* global_allocations;
+static THREADLOCAL int global_nallocations = 0;
 
 
 struct memoryElement
@@ -95,18 +112,18 @@ struct pointerStruct
     struct pointerStruct * lp;
     } *global_p, *global_ep;
 */
-struct memblock** pMemBlocks = 0; /* list of memblock, sorted
+THREADLOCAL struct memblock** pMemBlocks = 0; /* list of memblock, sorted
                                       according to memory address */
-static int NumberOfMemBlocks = 0;
+static THREADLOCAL int NumberOfMemBlocks = 0;
 #if SHOWMAXALLOCATED
-static int malloced = 0;
+static THREADLOCAL int malloced = 0;
 #endif
 
 #if DOSUMCHECK
 
-static int LineNo;
-static const char* FileName;
-static int globN;
+static THREADLOCAL int LineNo;
+static THREADLOCAL const char* FileName;
+static THREADLOCAL int globN;
 
 
 static int getchecksum(void)
@@ -127,7 +144,7 @@ static int getchecksum(void)
     return sum;
     }
 
-static int Checksum = 0;
+static THREADLOCAL int Checksum = 0;
 
 static void setChecksum(const char* file,int lineno, int n)
     {
@@ -142,7 +159,7 @@ static void setChecksum(const char* file,int lineno, int n)
 
 static void checksum(const char* file, int line)
     {
-    static int nChecksum = 0;
+    static THREADLOCAL int nChecksum = 0;
     nChecksum = getchecksum();
     if(Checksum && Checksum != nChecksum)
         {
@@ -156,6 +173,137 @@ static void checksum(const char* file, int line)
 #define checksum(a,b)
 #endif
 
+#if EVALUATIONARENA
+#if CHECKALLOCBOUNDS
+#error EVALUATIONARENA and CHECKALLOCBOUNDS cannot be combined
+#endif
+/*
+While stringEval() evaluates an expression, blocks of up to ARENAMAXBLOCK bytes
+are taken from a region (arena) by bumping a pointer. bfree() only counts down
+the number of blocks in the region that are still in use. As soon as that
+number is zero, the whole region is available again.
+At the end of stringEval(), the result is copied to the pools (see promoted()
+in copy.c), so that normally the region can be reused by the next call to
+stringEval(). If the region is more than half full and still in use, values of
+variables that reside in the region are copied to the pools as well. Blocks
+that cannot be copied, such as objects, keep the region alive. Such a region is
+retired and a new region is made. A retired region is freed when its last block
+is freed. As long as there are MAXRETIREDARENAS retired regions, no new
+region is made and blocks are taken from the pools.
+When a region is full during an evaluation, blocks are taken from the pools.
+*/
+#define ARENASIZE 0x40000
+#define ARENAMAXBLOCK 256
+#define MAXRETIREDARENAS 8
+
+struct arena
+    {
+    char* lowestAddress;
+    char* highestAddress;
+    char* next; /* first free byte */
+    size_t inUse; /* number of blocks that are not yet freed */
+    struct arena* older; /* list of retired arenas */
+    };
+
+static THREADLOCAL struct arena* theArena = NULL;
+static THREADLOCAL struct arena* retiredArenas = NULL;
+static THREADLOCAL int numberOfRetiredArenas = 0;
+static THREADLOCAL int arenaActive = 0;
+
+static void freeArena(struct arena* a)
+    {
+    free(a->lowestAddress);
+    free(a);
+    }
+
+static struct arena* newArena(void)
+    {
+    struct arena* a = (struct arena*)malloc(sizeof(struct arena));
+    if(a)
+        {
+        a->next = a->lowestAddress = (char*)malloc(ARENASIZE);
+        if(!a->lowestAddress)
+            {
+            free(a);
+            return NULL;
+            }
+        a->highestAddress = a->lowestAddress + ARENASIZE;
+        a->inUse = 0;
+        a->older = NULL;
+        }
+    return a;
+    }
+
+int arenaHalfFull(void)
+    {
+    return theArena
+        && theArena->inUse
+        && theArena->next - theArena->lowestAddress > ARENASIZE / 2;
+    }
+
+void beginArena(void)
+    {
+    if(arenaHalfFull())
+        {
+        if(numberOfRetiredArenas == MAXRETIREDARENAS)
+            return; /* Too many escaping blocks. Use the pools instead. */
+        theArena->older = retiredArenas;
+        retiredArenas = theArena;
+        ++numberOfRetiredArenas;
+        theArena = NULL;
+        }
+    if(!theArena)
+        theArena = newArena();
+    arenaActive = theArena != NULL;
+    }
+
+/* Returns nonzero if the arena was active. */
+int endArena(void)
+    {
+    int wasActive = arenaActive;
+    arenaActive = 0;
+    return wasActive;
+    }
+
+int inArena(void* p)
+    {
+    return theArena
+        && theArena->inUse
+        && theArena->lowestAddress <= (char*)p
+        && (char*)p < theArena->highestAddress;
+    }
+
+static int freedInArena(void* p)
+    {
+    struct arena** pa;
+    if(theArena
+       && theArena->lowestAddress <= (char*)p
+       && (char*)p < theArena->highestAddress
+       )
+        {
+        assert(theArena->inUse > 0);
+        if(--theArena->inUse == 0)
+            theArena->next = theArena->lowestAddress;
+        return 1;
+        }
+    for(pa = &retiredArenas; *pa; pa = &(*pa)->older)
+        {
+        if((*pa)->lowestAddress <= (char*)p && (char*)p < (*pa)->highestAddress)
+            {
+            if(--(*pa)->inUse == 0)
+                {
+                struct arena* a = *pa;
+                *pa = a->older;
+                --numberOfRetiredArenas;
+                freeArena(a);
+                }
+            return 1;
+            }
+        }
+    return 0;
+    }
+#endif
+
 static struct memblock* initializeMemBlock(size_t elementSize, size_t numberOfElements)
     {
     size_t nlongpointers;
@@ -214,12 +362,16 @@ static struct memblock* newMemBlocks(size_t n)
     struct memblock* mb;
     int i, j = 0;
     struct memblock** npMemBlocks;
-    mb = initializeMemBlock(global_allocations[n].elementSize, global_allocations[n].numberOfElements);
+    struct allocation* alloc = global_allocations + n;
+    mb = initializeMemBlock(alloc->elementSize, alloc->numberOfElements);
     if(!mb)
         return 0;
-    global_allocations[n].numberOfElements *= 2;
-    mb->previousOfSameLength = global_allocations[n].memoryBlock;
-    global_allocations[n].memoryBlock = mb;
+    alloc->capacity += alloc->numberOfElements;
+    alloc->numberOfElements = alloc->capacity < MAXBLOCKBYTES / alloc->elementSize
+        ? (int)alloc->capacity
+        : (int)(MAXBLOCKBYTES / alloc->elementSize);
+    mb->previousOfSameLength = alloc->memoryBlock;
+    alloc->memoryBlock = mb;
 
     ++NumberOfMemBlocks;
     npMemBlocks = (struct memblock**)malloc((NumberOfMemBlocks) * sizeof(struct memblock*));
@@ -227,7 +379,7 @@ static struct memblock* newMemBlocks(size_t n)
         {
         for(i = 0; i < NumberOfMemBlocks - 1; ++i)
             {
-            if(mb < pMemBlocks[i])
+            if(mb->lowestAddress < pMemBlocks[i]->lowestAddress)
                 {
                 npMemBlocks[j++] = mb;
                 for(; i < NumberOfMemBlocks - 1; ++i)
@@ -262,6 +414,26 @@ static struct memblock* newMemBlocks(size_t n)
 
     }
 
+/* pMemBlocks is sorted by address, so a binary search finds the block that
+   contains p, if any. */
+static struct memblock* findMemBlock(void* p)
+    {
+    int low = 0;
+    int high = NumberOfMemBlocks;
+    while(low < high)
+        {
+        int mid = (low + high) / 2;
+        struct memblock* mb = pMemBlocks[mid];
+        if((struct memoryElement*)p < mb->lowestAddress)
+            high = mid;
+        else if((struct memoryElement*)p >= mb->highestAddress)
+            low = mid + 1;
+        else
+            return mb;
+        }
+    return NULL;
+    }
+
 #if SHOWCURRENTLYALLOCATED
 void bezetting(void)
     {
@@ -318,30 +490,43 @@ void* Bmalloc(size_t n)
     n += 3 * sizeof(LONG);
 #endif
     checksum(__FILE__, __LINE__);
-    n = (n - 1) / sizeof(struct memoryElement);
-    if(n <
-#if _5_6
-       6
-#elif _4
-       4
-#else
-       3
+#if EVALUATIONARENA
+    if(arenaActive && n <= ARENAMAXBLOCK)
+        {
+        size_t words = (n - 1) / sizeof(struct memoryElement) + 1;
+        if((size_t)(theArena->highestAddress - theArena->next) >= words * sizeof(struct memoryElement))
+            {
+            ret = theArena->next;
+            theArena->next += words * sizeof(struct memoryElement);
+            ++theArena->inUse;
+            ((LONG*)ret)[words - 1] = 0;
+            ((LONG*)ret)[0] = 0;
+            return ret;
+            }
+        }
 #endif
-       )
+    n = (n - 1) / sizeof(struct memoryElement);
+    if(n < MAXPOOLWORDS)
         {
-        struct memblock* mb = global_allocations[n].memoryBlock;
-        ret = mb->firstFreeElementBetweenAddresses;
-        while(ret == 0)
+        struct allocation* alloc = global_allocations + n;
+        struct memblock* mb;
+        ++alloc->requests;
+        ret = 0;
+        for(mb = alloc->memoryBlock
+            ; mb && (ret = mb->firstFreeElementBetweenAddresses) == 0
+            ; mb = mb->previousOfSameLength
+            )
+            ;
+        if(ret == 0 && (alloc->memoryBlock || alloc->requests >= POOLTHRESHOLD))
             {
-            mb = mb->previousOfSameLength;
-            if(!mb)
-                mb = newMemBlocks(n);
-            if(!mb)
-                break;
-            ret = mb->firstFreeElementBetweenAddresses;
+            mb = newMemBlocks(n);
+            if(mb)
+                ret = mb->firstFreeElementBetweenAddresses;
             }
         if(ret != 0)
             {
+            if(++alloc->inUse > alloc->maxInUse)
+                alloc->maxInUse = alloc->inUse;
 #if SHOWMAXALLOCATED
             --(mb->numberOfFreeElementsBetweenAddresses);
             if(mb->numberOfFreeElementsBetweenAddresses < mb->minimumNumberOfFreeElementsBetweenAddresses)
@@ -575,7 +760,7 @@ void bfree(void* p)
     assert(p != (void*)&twoNode);
     assert(p != (void*)&fourNode);
     assert(p != (void*)&sjtNode);
-    struct memblock** q;
+    struct memblock* mb;
 #if CHECKALLOCBOUNDS
     LONG* lp = (LONG*)p;
 #endif
@@ -589,18 +774,21 @@ void bfree(void* p)
 #if SHOWMAXALLOCATED
     globalloc--;
 #endif
-    for(q = pMemBlocks + NumberOfMemBlocks; --q >= pMemBlocks;)
+#if EVALUATIONARENA
+    if(freedInArena(p))
+        return;
+#endif
+    mb = findMemBlock(p);
+    if(mb)
         {
-        if((*q)->lowestAddress <= (struct memoryElement*)p && (struct memoryElement*)p < (*q)->highestAddress)
-            {
+        --global_allocations[mb->sizeOfElement / sizeof(struct memoryElement) - 1].inUse;
 #if SHOWMAXALLOCATED
-            ++((*q)->numberOfFreeElementsBetweenAddresses);
+        ++(mb->numberOfFreeElementsBetweenAddresses);
 #endif
-            ((struct memoryElement*)p)->next = (*q)->firstFreeElementBetweenAddresses;
-            (*q)->firstFreeElementBetweenAddresses = (struct memoryElement*)p;
-            setChecksum(FileName,LineNo, globN);
-            return;
-            }
+        ((struct memoryElement*)p)->next = mb->firstFreeElementBetweenAddresses;
+        mb->firstFreeElementBetweenAddresses = (struct memoryElement*)p;
+        setChecksum(FileName,LineNo, globN);
+        return;
         }
     free(p);
 #if SHOWMAXALLOCATED
@@ -678,16 +866,7 @@ int memblocksort(const void* a, const void* b)
 int init_memoryspace(void)
     {
     int i;
-    global_allocations = (struct allocation*)malloc(sizeof(struct allocation)
-                                                    *
-#if _5_6
-                                                    6
-#elif _4
-                                                    4
-#else
-                                                    3
-#endif
-    );
+    global_allocations = (struct allocation*)malloc(sizeof(struct allocation) * MAXPOOLWORDS);
     global_nallocations = addAllocation(1 * sizeof(struct memoryElement), MEM1SIZE, 0, global_allocations);
     global_nallocations = addAllocation(2 * sizeof(struct memoryElement), MEM2SIZE, global_nallocations, global_allocations);
     global_nallocations = addAllocation(3 * sizeof(struct memoryElement), MEM3SIZE, global_nallocations, global_allocations);
@@ -706,6 +885,21 @@ int init_memoryspace(void)
         for(i = 0; i < NumberOfMemBlocks; ++i)
             {
             pMemBlocks[i] = global_allocations[i].memoryBlock = initializeMemBlock(global_allocations[i].elementSize, global_allocations[i].numberOfElements);
+            global_allocations[i].capacity = global_allocations[i].numberOfElements;
+            global_allocations[i].inUse = 0;
+            global_allocations[i].maxInUse = 0;
+            global_allocations[i].requests = 0;
+            }
+        for(; global_nallocations < MAXPOOLWORDS; ++global_nallocations)
+            {
+            struct allocation* alloc = global_allocations + global_nallocations;
+            alloc->elementSize = (global_nallocations + 1) * sizeof(struct memoryElement);
+            alloc->numberOfElements = NEWPOOLSIZE;
+            alloc->memoryBlock = NULL;
+            alloc->capacity = 0;
+            alloc->inUse = 0;
+            alloc->maxInUse = 0;
+            alloc->requests = 0;
             }
         qsort(pMemBlocks, NumberOfMemBlocks, sizeof(struct memblock*), memblocksort);
         /*
@@ -728,8 +922,52 @@ int init_memoryspace(void)
         return 0;
     }
 
+/* Returns statistics for mem$STA. For each size (in words) that has a pool:
+   bytes per element, number of blocks of elements, number of elements, number
+   of elements in use now and at most, and number of requests. For sizes that
+   have no pool (yet): the number of requests, which were served by malloc.
+   Finally the number of blocks currently allocated with malloc. */
+const char* memoryStatistics(void)
+    {
+    static THREADLOCAL char draft[MAXPOOLWORDS * 160 + 32];
+    char* d = draft;
+    int i;
+    *d = '\0';
+    for(i = 0; i < MAXPOOLWORDS; ++i)
+        {
+        struct allocation* alloc = global_allocations + i;
+        if(alloc->memoryBlock)
+            {
+            int blocks = 0;
+            struct memblock* mb;
+            for(mb = alloc->memoryBlock; mb; mb = mb->previousOfSameLength)
+                ++blocks;
+            d += sprintf(d
+                         , " (pool.%d (bytes." LONGU ") (blocks.%d) (elements." LONGU ") (used." LONGU ") (peak." LONGU ") (requests." LONGU "))"
+                         , i + 1
+                         , (ULONG)alloc->elementSize
+                         , blocks
+                         , (ULONG)alloc->capacity
+                         , (ULONG)alloc->inUse
+                         , (ULONG)alloc->maxInUse
+                         , (ULONG)alloc->requests
+            );
+            }
+        else if(alloc->requests)
+            {
+            d += sprintf(d, " (malloc.%d (requests." LONGU "))", i + 1, (ULONG)alloc->requests);
+            }
+        }
+#if SHOWMAXALLOCATED
+    sprintf(d, " (malloced.%d)", malloced);
+#endif
+    return draft;
+    }
+
 void pskfree(psk p)
     {
+    if(Op(p) == OR)
+        forgetAlternatives(p); /* hash table for pattern (a|b|c|...) */
     bfree(p);
     }
 
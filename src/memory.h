@@ -14,6 +14,7 @@ void* Bmalloc(size_t n);
 void dec_refcount(psk pnode);
 void bfree(void* p);
 void pskfree(psk p);
+const char* memoryStatistics(void);
 int all_refcount_bits_set(psk pnode);
 #if SHOWMAXALLOCATED
 #if SHOWCURRENTLYALLOCATED
@@ -21,4 +22,10 @@ void bezetting(void);
 #endif
 void Bez(char draft[22]);
 #endif
+#if EVALUATIONARENA
+void beginArena(void);
+int endArena(void);
+int arenaHalfFull(void);
+int inArena(void* p);
+#endif
 #endif
@@ -31,6 +31,21 @@
 #define _BRACMATEMBEDDED 0
 #endif
 
+/* Compile with -DPER_THREAD_INTERPRETER to give each thread its own,
+   independent interpreter. All mutable interpreter state is then thread-local.
+   Each thread must call startProc() before its first call to stringEval(). */
+#if defined PER_THREAD_INTERPRETER
+#if defined _MSC_VER
+#define THREADLOCAL __declspec(thread)
+#elif defined __GNUC__ || defined __clang__
+#define THREADLOCAL __thread
+#else
+#define THREADLOCAL _Thread_local
+#endif
+#else
+#define THREADLOCAL
+#endif
+
 #if (defined _Windows || defined _MT /*multithreaded, VC6.0*/)&& (!defined _CONSOLE && !defined __CONSOLE__ || defined NOTCONSOLE || _BRACMATEMBEDDED)
 /* _CONSOLE defined by Visual C++ and __CONSOLE__ seems always to be defined in C++Builder */
 #define MICROSOFT_WINDOWS_API 1
@@ -362,6 +377,7 @@ typedef struct
 #define RAW O('R','A','W')
 #define REV O('r','e','v') /* strrev */
 #define SIM O('s','i','m')
+#define STA O('S','T','A') /* mem$STA: statistics */
 #define STG O('S','T','R')
 #define STR O('s','t','r')
 #define TBL O('t','b','l')
@@ -156,6 +156,9 @@ blank " ", the comma "," and the full stop ".". (The interpunction symbols
 "?", "!" and ";" were already 'taken' to serve other purposes.)
 */
 
+#if defined SINGLESOURCE && (defined __unix__ || defined __APPLE__) && !defined _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE /* for calculation.c, which is included after the system headers */
+#endif
 #include "defines01.h"
 #include "platformdependentdefs.h"
 #include "flags.h"
@@ -188,7 +191,6 @@ blank " ", the comma "," and the full stop ".". (The interpunction symbols
 #define XML_H
 #define WRITEERR_H
 #define INPUT_H
-#define WIPECOPY_H
 #define RATIONAL_H
 #define REAL_H
 #define EQUAL_H
@@ -196,14 +198,12 @@ blank " ", the comma "," and the full stop ".". (The interpunction symbols
 #define NODEUTIL_H
 #define LAMBDA_H
 #define OPT_H
-#define VARIABLES_H
 #define MACRO_H
 #define HASH_H
 #define CALCULATION_H
 #define BINDING_H
 #define POSITION_H
 #define STRINGMATCH_H
-#define TREEMATCH_H
 #define BRANCH_H
 #define FILESTATUS_H
 #define SIMIL_H
@@ -466,7 +466,7 @@ int startProc(
 )
     {
     int err; /* evaluation of version string */
-    static int called = 0;
+    static THREADLOCAL int called = 0;
     if(called)
         {
         return 2;
@@ -560,6 +560,10 @@ int startProc(
     fourNode.v.fl = READY | SUCCESS | QNUMBER BITWISE_OR_SELFMATCHING;
     *(&(fourNode.u.obj) + 1) = 0;
 
+    knil[WHITE >> OPSH] = &nilNode;
+    knil[PLUS >> OPSH] = &zeroNode;
+    knil[TIMES >> OPSH] = &oneNode;
+
     m0 = build_up(m0, "?*(%+%)^~/#>1*?", NULL);
     m1 = build_up(m1, "?*(%+%)*?", NULL);
     f0 = build_up(f0, "(g,k,pow"
@@ -755,7 +759,7 @@ int startProc(
 void endProc(void)
     {
     int err;
-    static int called = 0;
+    static THREADLOCAL int called = 0;
     if(called)
         return;
     called = 1;
@@ -6,6 +6,7 @@
 #include "copy.h"
 #include "wipecopy.h"
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 /*
@@ -256,6 +257,390 @@ static LONG iSubtract2(LONG* highRemainder
         }
     }
 
+/*
+Multiplication and division of long numbers by divide and conquer.
+
+The functions below work on arrays of limbs with the least significant limb
+first, which is the reverse of the order in nnumber.inumber. All limbs are
+between 0 and RADIX - 1. nTimes() and nnDivide() only use these functions if
+both operands are long, because the usual algorithms are faster for numbers
+of a few hundred digits.
+
+Multiplication is done by Karatsuba's method, which needs three instead of four
+multiplications of numbers of half the length. Division is done as in
+Burnikel and Ziegler's recursive division: the quotient is computed in two
+halves, each half by a division of numbers of half the length and a
+multiplication. See R.P. Brent & P. Zimmermann, Modern Computer Arithmetic,
+algorithms 1.3, 1.6 and 1.8.
+
+{?} 3^200000:?x&!x*!x:?y&div$(!y,!x+1):?q&ok
+    Squaring: 295 ms before, 52 ms now
+    Division: 997 ms before, 98 ms now
+(See demo/bignum.bra)
+*/
+
+/* Below these lengths (in limbs), the schoolbook algorithms are used. The sum
+   of KARATSUBA_THRESHOLD products of two limbs must fit in a LONG. */
+#if WORD32
+#define KARATSUBA_THRESHOLD 16
+#define DIVISION_THRESHOLD 16
+#else
+#define KARATSUBA_THRESHOLD 32
+#define DIVISION_THRESHOLD 32
+#endif
+
+static size_t lTrim(const LONG* a, size_t n)
+    {
+    while(n > 1 && a[n - 1] == 0)
+        --n;
+    return n;
+    }
+
+static int lCompare(const LONG* a, const LONG* b, size_t n)
+    {
+    while(n-- > 0)
+        {
+        if(a[n] != b[n])
+            return a[n] < b[n] ? -1 : 1;
+        }
+    return 0;
+    }
+
+/* z += a. Returns the carry out of z. */
+static LONG lAdd(LONG* z, size_t nz, const LONG* a, size_t na)
+    {
+    LONG carry = 0;
+    size_t i;
+    assert(na <= nz);
+    for(i = 0; i < na; ++i)
+        {
+        LONG s = z[i] + a[i] + carry;
+        if(s >= RADIX)
+            {
+            z[i] = s - RADIX;
+            carry = 1;
+            }
+        else
+            {
+            z[i] = s;
+            carry = 0;
+            }
+        }
+    for(; carry && i < nz; ++i)
+        {
+        if(++z[i] == RADIX)
+            z[i] = 0;
+        else
+            carry = 0;
+        }
+    return carry;
+    }
+
+/* z -= a. Returns the borrow out of z. */
+static LONG lSubtract(LONG* z, size_t nz, const LONG* a, size_t na)
+    {
+    LONG borrow = 0;
+    size_t i;
+    na = lTrim(a, na);
+    assert(na <= nz);
+    for(i = 0; i < na; ++i)
+        {
+        LONG s = z[i] - a[i] - borrow;
+        if(s < 0)
+            {
+            z[i] = s + RADIX;
+            borrow = 1;
+            }
+        else
+            {
+            z[i] = s;
+            borrow = 0;
+            }
+        }
+    for(; borrow && i < nz; ++i)
+        {
+        if(--z[i] < 0)
+            z[i] = RADIX - 1;
+        else
+            borrow = 0;
+        }
+    return borrow;
+    }
+
+/* z[0 .. nx+ny-1] = x * y, column by column. */
+static void lTimesBase(const LONG* x, size_t nx, const LONG* y, size_t ny, LONG* z)
+    {
+    LONG carry = 0;
+    size_t k;
+    for(k = 0; k + 1 < nx + ny; ++k)
+        {
+        size_t i = k < ny ? 0 : k - ny + 1;
+        size_t e = k < nx ? k : nx - 1;
+        LONG acc = carry;
+        for(; i <= e; ++i)
+            acc += x[i] * y[k - i];
+        z[k] = acc % RADIX;
+        carry = acc / RADIX;
+        }
+    z[k] = carry;
+    }
+
+/* z[0 .. nx+ny-1] = x * y */
+static void lTimes(const LONG* x, size_t nx, const LONG* y, size_t ny, LONG* z)
+    {
+    if(nx < ny)
+        {
+        const LONG* t = x;
+        size_t nt = nx;
+        x = y;
+        nx = ny;
+        y = t;
+        ny = nt;
+        }
+    if(ny < KARATSUBA_THRESHOLD)
+        lTimesBase(x, nx, y, ny, z);
+    else if(nx >= 2 * ny)
+        {
+        /* Multiply y with slices of x that are as long as y. */
+        LONG* t = (LONG*)bmalloc(sizeof(LONG) * 2 * ny);
+        size_t off;
+        memset(z, 0, sizeof(LONG) * (nx + ny));
+        for(off = 0; off < nx; off += ny)
+            {
+            size_t n = nx - off < ny ? nx - off : ny;
+            lTimes(x + off, n, y, ny, t);
+            lAdd(z + off, nx + ny - off, t, n + ny);
+            }
+        bfree(t);
+        }
+    else
+        {
+        /* x = x1*R^m + x0, y = y1*R^m + y0, where R is RADIX.
+           x*y = x1*y1*R^2m + ((x0+x1)*(y0+y1) - x0*y0 - x1*y1)*R^m + x0*y0 */
+        size_t m = nx / 2;
+        size_t nsx = nx - m + 1;
+        size_t nsy = (ny - m > m ? ny - m : m) + 1;
+        LONG* sx = (LONG*)bmalloc(sizeof(LONG) * 2 * (nsx + nsy));
+        LONG* sy = sx + nsx;
+        LONG* t = sy + nsy;
+        size_t nt;
+        assert(m < ny);
+        lTimes(x, m, y, m, z);
+        lTimes(x + m, nx - m, y + m, ny - m, z + 2 * m);
+        memcpy(sx, x + m, sizeof(LONG) * (nx - m));
+        sx[nx - m] = 0;
+        lAdd(sx, nsx, x, m);
+        if(ny - m > m)
+            {
+            memcpy(sy, y + m, sizeof(LONG) * (ny - m));
+            sy[ny - m] = 0;
+            lAdd(sy, nsy, y, m);
+            }
+        else
+            {
+            memcpy(sy, y, sizeof(LONG) * m);
+            sy[m] = 0;
+            lAdd(sy, nsy, y + m, ny - m);
+            }
+        nsx = lTrim(sx, nsx);
+        nsy = lTrim(sy, nsy);
+        nt = nsx + nsy;
+        lTimes(sx, nsx, sy, nsy, t);
+        lSubtract(t, nt, z, 2 * m);
+        lSubtract(t, nt, z + 2 * m, nx + ny - 2 * m);
+        lAdd(z + m, nx + ny - m, t, lTrim(t, nt));
+        bfree(sx);
+        }
+    }
+
+/* a[0 .. n] -= q * b[0 .. n-1]. Returns 1 if the result is negative. */
+static int lSubtractMultiple(LONG* a, const LONG* b, size_t n, LONG q)
+    {
+    LONG borrow = 0;
+    LONG s;
+    size_t i;
+    for(i = 0; i < n; ++i)
+        {
+        LONG p = q * b[i] + borrow;
+        borrow = p / RADIX;
+        s = a[i] - p % RADIX;
+        if(s < 0)
+            {
+            s += RADIX;
+            ++borrow;
+            }
+        a[i] = s;
+        }
+    s = a[n] - borrow;
+    if(s < 0)
+        {
+        a[n] = s + RADIX;
+        return 1;
+        }
+    a[n] = s;
+    return 0;
+    }
+
+static void lDecrement(LONG* q, size_t n)
+    {
+    size_t i;
+    for(i = 0; i < n && --q[i] < 0; ++i)
+        q[i] = RADIX - 1;
+    }
+
+/* Schoolbook division. b has nb limbs and b[nb-1] >= RADIX/2.
+   The quotient goes to q[0 .. na-nb], the remainder to a[0 .. nb-1]. */
+static void lDivideBase(LONG* a, size_t na, const LONG* b, size_t nb, LONG* q)
+    {
+    size_t m = na - nb;
+    size_t j;
+    if(lCompare(a + m, b, nb) >= 0)
+        {
+        lSubtract(a + m, nb, b, nb);
+        q[m] = 1;
+        }
+    else
+        q[m] = 0;
+    for(j = m; j-- > 0;)
+        {
+        LONG qhat = (a[nb + j] * RADIX + a[nb + j - 1]) / b[nb - 1];
+        if(qhat >= RADIX)
+            qhat = RADIX - 1;
+        if(lSubtractMultiple(a + j, b, nb, qhat))
+            {
+            do
+                --qhat;
+            while(!lAdd(a + j, nb + 1, b, nb));
+            }
+        q[j] = qhat;
+        }
+    }
+
+/* Recursive division. Requires na - nb <= nb and b[nb-1] >= RADIX/2.
+   The quotient goes to q[0 .. na-nb], the remainder to a[0 .. nb-1]. */
+static void lDivideRecursive(LONG* a, size_t na, const LONG* b, size_t nb, LONG* q)
+    {
+    size_t m = na - nb;
+    size_t k;
+    LONG* q1, * q0, * t;
+    if(m < DIVISION_THRESHOLD)
+        {
+        lDivideBase(a, na, b, nb, q);
+        return;
+        }
+    /* b = b1*R^k + b0. First the upper half of the quotient. */
+    k = m / 2;
+    q1 = (LONG*)bmalloc(sizeof(LONG) * (2 * m + 3));
+    q0 = q1 + (m - k + 1);
+    t = q0 + (k + 1);
+    lDivideRecursive(a + 2 * k, na - 2 * k, b + k, nb - k, q1);
+    lTimes(q1, m - k + 1, b, k, t);
+    if(lSubtract(a + k, na - k, t, m + 1))
+        {
+        do
+            lDecrement(q1, m - k + 1);
+        while(!lAdd(a + k, na - k, b, nb));
+        }
+    /* Then the lower half. */
+    lDivideRecursive(a + k, nb, b + k, nb - k, q0);
+    lTimes(q0, k + 1, b, k, t);
+    if(lSubtract(a, na, t, 2 * k + 1))
+        {
+        do
+            lDecrement(q0, k + 1);
+        while(!lAdd(a, na, b, nb));
+        }
+    memset(q, 0, sizeof(LONG) * (m + 1));
+    memcpy(q, q0, sizeof(LONG) * (k + 1));
+    lAdd(q + k, m + 1 - k, q1, m - k + 1);
+    bfree(q1);
+    }
+
+/* Division of a number of any length. Requires na >= nb and
+   b[nb-1] >= RADIX/2. The quotient goes to q[0 .. na-nb], the remainder to
+   a[0 .. nb-1]. */
+static void lDivide(LONG* a, size_t na, const LONG* b, size_t nb, LONG* q)
+    {
+    LONG* t;
+    size_t m = na - nb;
+    if(m <= nb)
+        {
+        lDivideRecursive(a, na, b, nb, q);
+        return;
+        }
+    /* Divide slices of nb limbs, starting at the most significant end. */
+    t = (LONG*)bmalloc(sizeof(LONG) * (nb + 1));
+    memset(q, 0, sizeof(LONG) * (m + 1));
+    while(na - nb > nb)
+        {
+        size_t s = na - 2 * nb;
+        lDivideRecursive(a + s, 2 * nb, b, nb, t);
+        lAdd(q + s, m + 1 - s, t, nb + 1);
+        na -= nb;
+        }
+    lDivideRecursive(a, na, b, nb, t);
+    lAdd(q, m + 1, t, na - nb + 1);
+    bfree(t);
+    }
+
+static void lReverse(LONG* dst, const LONG* src, size_t n)
+    {
+    size_t i;
+    for(i = 0; i < n; ++i)
+        dst[i] = src[n - 1 - i];
+    }
+
+static void lTimesLimb(LONG* a, size_t n, LONG d)
+    {
+    LONG carry = 0;
+    size_t i;
+    for(i = 0; i < n; ++i)
+        {
+        LONG p = a[i] * d + carry;
+        a[i] = p % RADIX;
+        carry = p / RADIX;
+        }
+    assert(carry == 0);
+    }
+
+static void lDivideLimb(LONG* a, size_t n, LONG d)
+    {
+    LONG r = 0;
+    while(n-- > 0)
+        {
+        LONG p = r * RADIX + a[n];
+        a[n] = p / d;
+        r = p % d;
+        }
+    assert(r == 0);
+    }
+
+/* nnDivide() for long numbers. quot and rem are as long as the quotient and
+   the dividend, most significant limb first. */
+static void nnDivideLong(nnumber* dividend, nnumber* divisor, LONG* quot, LONG* rem)
+    {
+    size_t na = (size_t)dividend->ilength + 1;
+    size_t nb = (size_t)divisor->ilength;
+    LONG* a = (LONG*)bmalloc(sizeof(LONG) * (2 * na + 1));
+    LONG* b = a + na;
+    LONG* q = b + nb;
+    /* Scale both numbers so that the leading limb of the divisor is at least
+       RADIX/2. (Knuth, TAOCP vol. 2, 4.3.1, algorithm D.) */
+    LONG d = RADIX / (divisor->inumber[0] + 1);
+    lReverse(a, dividend->inumber, na - 1);
+    a[na - 1] = 0;
+    lReverse(b, divisor->inumber, nb);
+    lTimesLimb(a, na, d);
+    lTimesLimb(b, nb, d);
+    assert(2 * b[nb - 1] >= RADIX);
+    lDivide(a, na, b, nb, q);
+    assert(q[na - nb] == 0);
+    lDivideLimb(a, nb, d);
+    lReverse(quot, q, na - nb);
+    lReverse(rem, a, na - 1);
+    bfree(a);
+    }
+
 static LONG nnDivide(nnumber* dividend, nnumber* divisor, nnumber* quotient, nnumber* remainder)
     {
     LONG* low, * quot, * head, * oldhead;
@@ -295,91 +680,96 @@ static LONG nnDivide(nnumber* dividend, nnumber* divisor, nnumber* quotient, nnu
     memset(quotient->inumber, 0, (size_t)(quotient->iallocated) * sizeof(LONG));
     quot = quotient->inumber;
 
-    divRADIX = divisor->inumber[0];
-    if(divisor->ilength > 1)
-        {
-        divRADIX2 = RADIX * divisor->inumber[0] + divisor->inumber[1];
-        }
+    if(divisor->ilength >= DIVISION_THRESHOLD && quotient->ilength >= DIVISION_THRESHOLD)
+        nnDivideLong(dividend, divisor, quotient->inumber, remainder->inumber);
     else
         {
-        divRADIX2 = 0;
-        }
-    assert(divRADIX > 0);
-    for(low = remainder->inumber + (size_t)divisor->ilength - 1
-        , head = oldhead = remainder->inumber
-        ; low < remainder->inumber + dividend->ilength
-        ; ++low, ++quot, ++head
-        )
-        {
-        LONG sign = 1;
-        LONG factor;
-        *quot = 0;
-        if(head > oldhead)
+        divRADIX = divisor->inumber[0];
+        if(divisor->ilength > 1)
             {
-            *head += RADIX * *oldhead;
-            *oldhead = 0;
-            oldhead = head;
+            divRADIX2 = RADIX * divisor->inumber[0] + divisor->inumber[1];
             }
-        do
+        else
             {
-            assert(low < remainder->inumber + remainder->ilength);
-            assert(quot < quotient->inumber + quotient->ilength);
-            assert(sign != 0);
-
-            assert(*head >= 0);
-            factor = *head / divRADIX;
-            if(sign == -1 && factor == 0)
-                ++factor;
-
-            if(factor == 0)
+            divRADIX2 = 0;
+            }
+        assert(divRADIX > 0);
+        for(low = remainder->inumber + (size_t)divisor->ilength - 1
+            , head = oldhead = remainder->inumber
+            ; low < remainder->inumber + dividend->ilength
+            ; ++low, ++quot, ++head
+            )
+            {
+            LONG sign = 1;
+            LONG factor;
+            *quot = 0;
+            if(head > oldhead)
                 {
-                break;
+                *head += RADIX * *oldhead;
+                *oldhead = 0;
+                oldhead = head;
                 }
-            else
+            do
                 {
-                LONG nsign;
-                assert(factor > 0);
-                if(divRADIX2)
+                assert(low < remainder->inumber + remainder->ilength);
+                assert(quot < quotient->inumber + quotient->ilength);
+                assert(sign != 0);
+
+                assert(*head >= 0);
+                factor = *head / divRADIX;
+                if(sign == -1 && factor == 0)
+                    ++factor;
+
+                if(factor == 0)
+                    {
+                    break;
+                    }
+                else
                     {
-                    assert(head + 1 <= low);
-                    if(head[0] < HEADROOM * RADIX)
+                    LONG nsign;
+                    assert(factor > 0);
+                    if(divRADIX2)
                         {
-                        factor = (RADIX * head[0] + head[1]) / divRADIX2;
-                        if(sign == -1 && factor == 0)
-                            ++factor;
+                        assert(head + 1 <= low);
+                        if(head[0] < HEADROOM * RADIX)
+                            {
+                            factor = (RADIX * head[0] + head[1]) / divRADIX2;
+                            if(sign == -1 && factor == 0)
+                                ++factor;
+                            }
                         }
+                    /*
+                    div$(20999900000000,2099990001) -> factor 10499
+                        (RADIX 4 HEADROOM 20)
+                    div$(2999000000,2999001)        -> factor 1499
+                        (RADIX 3 HEADROOM 2)
+                    */
+                    assert(factor * HEADROOM < RADIX * (HEADROOM + 1));
+                    *quot += sign * factor;
+                    assert(0 <= *quot);
+                    /*assert(*quot < RADIX);*/
+                    nsign = iSubtract2(head
+                                       , low
+                                       , divisor->inumber
+                                       , divisor->inumber + divisor->ilength - 1
+                                       , factor
+                    );
+                    assert(*head >= 0);
+                    assert(sign != 0);
+                    if(nsign < 0)
+                        sign = -sign;
+                    else if(nsign == 0)
+                        sign = 0;
                     }
+                } while(sign < 0);
                 /*
-                div$(20999900000000,2099990001) -> factor 10499
-                    (RADIX 4 HEADROOM 20)
-                div$(2999000000,2999001)        -> factor 1499
-                    (RADIX 3 HEADROOM 2)
+                checkBounds(remainder->ialloc);
+                checkBounds(quotient->ialloc);
+                checkBounds(remainder->ialloc);
+                checkBounds(quotient->ialloc);
                 */
-                assert(factor * HEADROOM < RADIX * (HEADROOM + 1));
-                *quot += sign * factor;
-                assert(0 <= *quot);
-                /*assert(*quot < RADIX);*/
-                nsign = iSubtract2(head
-                                   , low
-                                   , divisor->inumber
-                                   , divisor->inumber + divisor->ilength - 1
-                                   , factor
-                );
-                assert(*head >= 0);
-                assert(sign != 0);
-                if(nsign < 0)
-                    sign = -sign;
-                else if(nsign == 0)
-                    sign = 0;
-                }
-            } while(sign < 0);
-            /*
-            checkBounds(remainder->ialloc);
-            checkBounds(quotient->ialloc);
-            checkBounds(remainder->ialloc);
-            checkBounds(quotient->ialloc);
-            */
-            assert(*quot < RADIX);
+                assert(*quot < RADIX);
+            }
         }
     /*
     checkBounds(remainder->ialloc);
@@ -418,6 +808,13 @@ static LONG nnDivide(nnumber* dividend, nnumber* divisor, nnumber* quotient, nnu
 /* Create a node from a number, allocating memory for the node.
 The numbers' memory isn't deallocated. */
 
+static const char digitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
 static char* iconvert2decimal(nnumber* res, char* g)
     {
     LONG* ipointer;
@@ -432,16 +829,148 @@ static char* iconvert2decimal(nnumber* res, char* g)
             g += sprintf(g, LONGD, *ipointer);
             for(; ++ipointer < res->inumber + res->ilength;)
                 {
+                /* Much faster than sprintf(g, LONG0nD, (int)TEN_LOG_RADIX, *ipointer) */
+                unsigned int limb = (unsigned int)*ipointer;
+                int k;
                 assert(*ipointer >= 0);
                 assert(*ipointer < RADIX);
-                g += sprintf(g,/*"%0*ld"*/LONG0nD, (int)TEN_LOG_RADIX, *ipointer);
+                for(k = (int)TEN_LOG_RADIX; k > 0; k -= 2)
+                    {
+                    unsigned int pair = limb % 100;
+                    limb /= 100;
+                    g[k - 2] = digitPairs[2 * pair];
+                    g[k - 1] = digitPairs[2 * pair + 1];
+                    }
+                g += TEN_LOG_RADIX;
                 }
+            *g = '\0';
             break;
             }
         }
     return g;
     }
 
+/*
+Binary forms of long numbers.
+
+A number node holds the decimal text of the number. Each arithmetic operation
+converts the text of its operands to limbs and the limbs of its result back to
+text. In a loop like whl'(...&!i*!f:?f) the result of one operation is an
+operand of the next one, so the same number is converted back and forth each
+time. Therefore the limbs of the most recent long results are kept, together
+with the node and a copy of its text. isplit() and lowestTerms() copy the
+limbs instead of converting the text if they get the same node with the same
+text. (Nodes are freed and reused without notice, hence the comparison of the
+texts.) Only results in lowest terms are remembered. The limbs are released by
+bez$.
+
+{?} 1:?f&0:?i&whl'(1+!i:~>10000:?i&!i*!f:?f)
+    2.60 s before, 0.31 s now (faster conversion to text included)
+*/
+#define BINARYCACHE 8
+#define BINARYMINLENGTH 64 /* Shorter numbers are converted quickly. */
+
+typedef struct binaryNumber
+    {
+    psk node;
+    int flags; /* MINUS, QNUL, QFRACTION */
+    size_t textlength;
+    char* text;
+    LONG* limbs; /* numerator followed by denominator */
+    ptrdiff_t numeratorlength;
+    ptrdiff_t denominatorlength; /* 0 if the number is an integer */
+    } binaryNumber;
+
+static THREADLOCAL binaryNumber binaryCache[BINARYCACHE];
+static THREADLOCAL unsigned int binaryCacheNext = 0;
+
+static void rememberBinary(psk node, nnumber* num, nnumber* den)
+    {
+    binaryNumber* entry;
+    size_t textlength = strlen((char*)POBJ(node));
+    size_t nlimbs;
+    if(textlength < BINARYMINLENGTH)
+        return;
+    entry = binaryCache + binaryCacheNext;
+    binaryCacheNext = (binaryCacheNext + 1) % BINARYCACHE;
+    if(entry->limbs)
+        bfree(entry->limbs);
+    entry->node = 0;
+    nlimbs = (size_t)num->ilength + (den ? (size_t)den->ilength : 0);
+    entry->limbs = (LONG*)bmalloc(nlimbs * sizeof(LONG) + textlength + 1);
+    if(entry->limbs == 0)
+        return;
+#if EVALUATIONARENA
+    if(inArena(entry->limbs)) /* would keep the arena alive */
+        {
+        bfree(entry->limbs);
+        entry->limbs = 0;
+        return;
+        }
+#endif
+    entry->node = node;
+    entry->flags = (int)(node->v.fl & (MINUS | QNUL | QFRACTION));
+    entry->textlength = textlength;
+    entry->numeratorlength = num->ilength;
+    entry->denominatorlength = den ? den->ilength : 0;
+    memcpy(entry->limbs, num->inumber, (size_t)num->ilength * sizeof(LONG));
+    if(den)
+        memcpy(entry->limbs + num->ilength, den->inumber, (size_t)den->ilength * sizeof(LONG));
+    entry->text = (char*)(entry->limbs + nlimbs);
+    memcpy(entry->text, POBJ(node), textlength + 1);
+    }
+
+void releaseBinaryNumbers(void)
+    {
+    int k;
+    for(k = 0; k < BINARYCACHE; ++k)
+        {
+        if(binaryCache[k].limbs)
+            {
+            bfree(binaryCache[k].limbs);
+            binaryCache[k].limbs = 0;
+            }
+        binaryCache[k].node = 0;
+        }
+    }
+
+static void copyLimbs(nnumber* x, const LONG* limbs, ptrdiff_t n)
+    {
+    x->ilength = n;
+    x->iallocated = (size_t)n;
+    x->inumber = (LONG*)(x->ialloc = bmalloc(sizeof(LONG) * (size_t)n));
+    memcpy(x->inumber, limbs, sizeof(LONG) * (size_t)n);
+    }
+
+/* Sets the limbs of num and den if node is one of the remembered numbers.
+   num and den must have been made by split(). */
+static int recallBinary(psk node, nnumber* num, nnumber* den)
+    {
+    size_t textlength = (size_t)num->length + (node->v.fl & QFRACTION ? 1 + (size_t)den->length : 0);
+    int k;
+    if(textlength < BINARYMINLENGTH)
+        return FALSE;
+    for(k = 0; k < BINARYCACHE; ++k)
+        {
+        binaryNumber* entry = binaryCache + k;
+        if(entry->node == node
+           && entry->textlength == textlength
+           && entry->flags == (int)(node->v.fl & (MINUS | QNUL | QFRACTION))
+           && !memcmp(entry->text, POBJ(node), textlength)
+           )
+            {
+            static const LONG one = 1;
+            copyLimbs(num, entry->limbs, entry->numeratorlength);
+            if(entry->denominatorlength)
+                copyLimbs(den, entry->limbs + entry->numeratorlength, entry->denominatorlength);
+            else
+                copyLimbs(den, &one, 1);
+            return TRUE;
+            }
+        }
+    return FALSE;
+    }
+
 static psk inumberNode(nnumber* g)
     {
     psk res;
@@ -457,6 +986,7 @@ static psk inumberNode(nnumber* g)
 
     res->v.fl = READY | SUCCESS | QNUMBER BITWISE_OR_SELFMATCHING;
     res->v.fl |= g->sign;
+    rememberBinary(res, g, NULL);
     return res;
     }
 
@@ -488,6 +1018,7 @@ static Qnumber nn2q(nnumber* num, nnumber* den)
         assert((size_t)(endp - (char*)res) <= len);
         res->v.fl = READY | SUCCESS | QNUMBER | QFRACTION BITWISE_OR_SELFMATCHING;
         res->v.fl |= num->sign;
+        rememberBinary(res, num, den);
         }
     return res;
     }
@@ -502,12 +1033,221 @@ static Qnumber not_a_number(void)
 
 
 
+/*
+Greatest common divisors.
+
+Fractions used to be reduced by Euclid's algorithm, doing a long division for
+each quotient, although most quotients are small. Lehmer's algorithm finds
+several quotients at once from the leading limbs of the two numbers and
+applies them in one pass over the limbs. A long division is only done if a
+quotient is too large for that. The last steps, when the numbers fit in a
+LONG, are done with machine arithmetic. See Knuth, TAOCP vol. 2, 4.5.2,
+algorithm L. The arrays of limbs have the least significant limb first.
+
+{?} 0:?s&0:?i&whl'(1+!i:~>2000:?i&!s+!i^-1:?s)
+    679 ms before, 11 ms now (together with qPlusReduced())
+*/
+
+/* a = a mod b. b[nb-1] must not be 0. The limbs a[nb .. na-1] become 0.
+   Returns the length of the remainder. */
+static size_t lModulo(LONG* a, size_t na, const LONG* b, size_t nb)
+    {
+    LONG* s, * as, * bs, * q;
+    LONG d;
+    if(na < nb)
+        return na;
+    if(nb == 1)
+        {
+        LONG r = 0;
+        size_t i;
+        for(i = na; i-- > 0;)
+            {
+            r = (r * RADIX + a[i]) % b[0];
+            a[i] = 0;
+            }
+        a[0] = r;
+        return 1;
+        }
+    s = (LONG*)bmalloc(sizeof(LONG) * (2 * na + 3));
+    as = s;
+    bs = as + na + 1;
+    q = bs + nb;
+    d = RADIX / (b[nb - 1] + 1);
+    memcpy(as, a, sizeof(LONG) * na);
+    as[na] = 0;
+    memcpy(bs, b, sizeof(LONG) * nb);
+    lTimesLimb(as, na + 1, d);
+    lTimesLimb(bs, nb, d);
+    lDivide(as, na + 1, bs, nb, q);
+    lDivideLimb(as, nb, d);
+    memcpy(a, as, sizeof(LONG) * nb);
+    memset(a + nb, 0, sizeof(LONG) * (na - nb));
+    bfree(s);
+    return lTrim(a, nb);
+    }
+
+/* (a, b) = (A*a + B*b, C*a + D*b). The cofactors are less than RADIX in
+   absolute value and the results must not be negative. */
+static void lCombine(LONG* a, LONG* b, size_t n, LONG A, LONG B, LONG C, LONG D)
+    {
+    LONG ca = 0, cb = 0;
+    size_t i;
+    for(i = 0; i < n; ++i)
+        {
+        LONG s = A * a[i] + B * b[i] + ca;
+        LONG t = C * a[i] + D * b[i] + cb;
+        ca = s / RADIX;
+        s %= RADIX;
+        if(s < 0)
+            {
+            s += RADIX;
+            --ca;
+            }
+        cb = t / RADIX;
+        t %= RADIX;
+        if(t < 0)
+            {
+            t += RADIX;
+            --cb;
+            }
+        a[i] = s;
+        b[i] = t;
+        }
+    assert(ca == 0 && cb == 0);
+    }
+
+/* gcd = greatest common divisor of x and y, which must not both be 0. */
+static void nGcd(nnumber* x, nnumber* y, nnumber* gcd)
+    {
+    size_t na = (size_t)x->ilength, nb = (size_t)y->ilength;
+    size_t n = na > nb ? na : nb;
+    LONG* a = (LONG*)bmalloc(sizeof(LONG) * 2 * n);
+    LONG* b = a + n;
+    LONG* buffer = a;
+    LONG u, v;
+    memset(a, 0, sizeof(LONG) * 2 * n);
+    lReverse(a, x->inumber, na);
+    lReverse(b, y->inumber, nb);
+    if(na < nb || (na == nb && lCompare(a, b, na) < 0))
+        {
+        LONG* t = a;
+        a = b;
+        b = t;
+        n = na;
+        na = nb;
+        nb = n;
+        }
+    while(nb > 2)
+        {
+        LONG ah = a[na - 1] * RADIX + a[na - 2];
+        LONG bh = nb == na ? b[na - 1] * RADIX + b[na - 2] : nb + 1 == na ? b[na - 2] : 0;
+        LONG A = 1, B = 0, C = 0, D = 1;
+        for(;;)
+            {
+            LONG q, T, U;
+            if(bh + C == 0 || bh + D == 0)
+                break;
+            q = (ah + A) / (bh + C);
+            if(q >= RADIX || q != (ah + B) / (bh + D))
+                break;
+            T = A - q * C;
+            U = B - q * D;
+            if(T <= -RADIX || T >= RADIX || U <= -RADIX || U >= RADIX)
+                break;
+            A = C;
+            C = T;
+            B = D;
+            D = U;
+            T = ah - q * bh;
+            ah = bh;
+            bh = T;
+            }
+        if(B == 0)
+            {
+            LONG* t = a;
+            size_t nr = lModulo(a, na, b, nb);
+            a = b;
+            b = t;
+            na = nb;
+            nb = nr;
+            }
+        else
+            {
+            lCombine(a, b, na, A, B, C, D);
+            nb = lTrim(b, na);
+            na = lTrim(a, na);
+            }
+        }
+    if(nb == 1 && b[0] == 0)
+        {
+        gcd->ilength = (ptrdiff_t)na;
+        gcd->iallocated = na;
+        gcd->inumber = (LONG*)(gcd->ialloc = bmalloc(sizeof(LONG) * na));
+        lReverse(gcd->inumber, a, na);
+        }
+    else
+        {
+        na = lModulo(a, na, b, nb);
+        u = nb == 2 ? b[1] * RADIX + b[0] : b[0];
+        v = na == 2 ? a[1] * RADIX + a[0] : a[0];
+        while(v != 0)
+            {
+            LONG r = u % v;
+            u = v;
+            v = r;
+            }
+        gcd->ilength = u >= RADIX ? 2 : 1;
+        gcd->iallocated = (size_t)gcd->ilength;
+        gcd->inumber = (LONG*)(gcd->ialloc = bmalloc(sizeof(LONG) * gcd->iallocated));
+        if(u >= RADIX)
+            {
+            gcd->inumber[0] = u / RADIX;
+            gcd->inumber[1] = u % RADIX;
+            }
+        else
+            gcd->inumber[0] = u;
+        }
+    gcd->sign = 0;
+    bfree(buffer);
+    }
+
+static int isOne(nnumber* x)
+    {
+    return x->ilength == 1 && x->inumber[0] == 1;
+    }
+
+/* quotient = x / g, where g divides x. */
+static void nDivideExactly(nnumber* x, nnumber* g, nnumber* quotient)
+    {
+    if(isOne(g))
+        {
+        copyLimbs(quotient, x->inumber, x->ilength);
+        quotient->sign = x->sign;
+        }
+    else
+        {
+        nnumber remainder = { 0 };
+        nnDivide(x, g, quotient, &remainder);
+        assert(remainder.sign & QNUL);
+        bfree(remainder.ialloc);
+        }
+    }
+
+static int coprime(nnumber* x, nnumber* y)
+    {
+    nnumber gcd = { 0 };
+    int res;
+    nGcd(x, y, &gcd);
+    res = isOne(&gcd);
+    bfree(gcd.ialloc);
+    return res;
+    }
+
 Qnumber qnDivide(nnumber* x, nnumber* y)
     {
     Qnumber res;
-    nnumber gcd = { 0 }, hrem = { 0 };
-    nnumber quotientx = { 0 }, remainderx = { 0 };
-    nnumber quotienty = { 0 }, remaindery = { 0 };
+    nnumber gcd = { 0 };
+    nnumber quotientx = { 0 }, quotienty = { 0 };
 
 #ifndef NDEBUG
     valid(x);
@@ -518,64 +1258,14 @@ Qnumber qnDivide(nnumber* x, nnumber* y)
     else if(y->sign & QNUL)
         return not_a_number();
 
-    gcd = *x;
-    gcd.alloc = NULL;
-    gcd.ialloc = NULL;
-    hrem = *y;
-    hrem.alloc = NULL;
-    hrem.ialloc = NULL;
-    do
-        {
-        nnDivide(&gcd, &hrem, &quotientx, &remainderx);
-#ifndef NDEBUG
-        valid(&gcd);
-        valid(&hrem);
-        valid(&quotientx);
-        valid(&remainderx);
-#endif
-        if(gcd.ialloc)
-            {
-            bfree(gcd.ialloc);
-            }
-        gcd = hrem;
-        hrem = remainderx;
-        remainderx.alloc = 0;
-        remainderx.length = 0;
-        bfree(quotientx.ialloc);
-        remainderx.ialloc = 0;
-        remainderx.ilength = 0;
-        quotientx.ialloc = 0;
-        quotientx.alloc = 0;
-        quotientx.ilength = 0;
-        quotientx.length = 0;
-        } while(!(hrem.sign & QNUL));
-
-        if(hrem.ialloc)
-            bfree(hrem.ialloc);
-
-        nnDivide(x, &gcd, &quotientx, &remainderx);
-#ifndef NDEBUG
-        valid(&gcd);
-        valid(x);
-        valid(&quotientx);
-        valid(&remainderx);
-#endif
-        bfree(remainderx.ialloc);
-        nnDivide(y, &gcd, &quotienty, &remaindery);
-#ifndef NDEBUG
-        valid(&gcd);
-        valid(y);
-        valid(&quotienty);
-        valid(&remaindery);
-#endif
-        bfree(remaindery.ialloc);
-
-        if(gcd.ialloc)
-            bfree(gcd.ialloc);
-        res = nn2q(&quotientx, &quotienty);
-        bfree(quotientx.ialloc);
-        bfree(quotienty.ialloc);
-        return res;
+    nGcd(x, y, &gcd);
+    nDivideExactly(x, &gcd, &quotientx);
+    nDivideExactly(y, &gcd, &quotienty);
+    bfree(gcd.ialloc);
+    res = nn2q(&quotientx, &quotienty);
+    bfree(quotientx.ialloc);
+    bfree(quotienty.ialloc);
+    return res;
     }
 
 
@@ -592,61 +1282,77 @@ static void nTimes(nnumber* x, nnumber* y, nnumber* product)
     assert(product->iallocated > 0);
     product->inumber = (LONG*)(product->ialloc = bmalloc(sizeof(LONG) * product->iallocated));
 
-    for(ipointer = product->inumber; ipointer < product->inumber + product->ilength; *ipointer++ = 0)
-        ;
-
-    for(I1 = x->inumber + x->ilength - 1; I1 >= x->inumber; I1--)
+    if(x->ilength >= KARATSUBA_THRESHOLD && y->ilength >= KARATSUBA_THRESHOLD)
         {
-        itussen = --ipointer; /* pointer to result, starting from LSW. */
-        assert(itussen >= product->inumber);
-        for(I2 = y->inumber + y->ilength - 1; I2 >= y->inumber; I2--)
+        size_t nx = (size_t)x->ilength;
+        size_t ny = (size_t)y->ilength;
+        LONG* lx = (LONG*)bmalloc(sizeof(LONG) * 2 * (nx + ny));
+        LONG* ly = lx + nx;
+        LONG* lz = ly + ny;
+        lReverse(lx, x->inumber, nx);
+        lReverse(ly, y->inumber, ny);
+        lTimes(lx, nx, ly, ny, lz);
+        lReverse(product->inumber, lz, nx + ny);
+        bfree(lx);
+        }
+    else
+        {
+        for(ipointer = product->inumber; ipointer < product->inumber + product->ilength; *ipointer++ = 0)
+            ;
+
+        for(I1 = x->inumber + x->ilength - 1; I1 >= x->inumber; I1--)
             {
-            LONG prod;
-            LONG* itussen2;
-            prod = (*I1) * (*I2);
-            *itussen += prod;
-            itussen2 = itussen--;
-            while(*itussen2 >= HEADROOM * RADIX2)
+            itussen = --ipointer; /* pointer to result, starting from LSW. */
+            assert(itussen >= product->inumber);
+            for(I2 = y->inumber + y->ilength - 1; I2 >= y->inumber; I2--)
                 {
-                LONG karry;
-                karry = *itussen2 / RADIX;
-                *itussen2 %= RADIX;
-                --itussen2;
+                LONG prod;
+                LONG* itussen2;
+                prod = (*I1) * (*I2);
+                *itussen += prod;
+                itussen2 = itussen--;
+                while(*itussen2 >= HEADROOM * RADIX2)
+                    {
+                    LONG karry;
+                    karry = *itussen2 / RADIX;
+                    *itussen2 %= RADIX;
+                    --itussen2;
+                    assert(itussen2 >= product->inumber);
+                    *itussen2 += karry;
+                    }
                 assert(itussen2 >= product->inumber);
-                *itussen2 += karry;
                 }
-            assert(itussen2 >= product->inumber);
-            }
-        if(*ipointer >= RADIX)
-            {
-            LONG karry = *ipointer / RADIX;
-            *ipointer %= RADIX;
-            itussen = ipointer - 1;
-            assert(itussen >= product->inumber);
-            *itussen += karry;
-            while(*itussen >= HEADROOM * RADIX2/* 2000000000 */)
+            if(*ipointer >= RADIX)
                 {
-                karry = *itussen / RADIX;
-                *itussen %= RADIX;
-                --itussen;
+                LONG karry = *ipointer / RADIX;
+                *ipointer %= RADIX;
+                itussen = ipointer - 1;
                 assert(itussen >= product->inumber);
                 *itussen += karry;
+                while(*itussen >= HEADROOM * RADIX2/* 2000000000 */)
+                    {
+                    karry = *itussen / RADIX;
+                    *itussen %= RADIX;
+                    --itussen;
+                    assert(itussen >= product->inumber);
+                    *itussen += karry;
+                    }
+                assert(itussen >= product->inumber);
                 }
-            assert(itussen >= product->inumber);
             }
-        }
-    while(ipointer >= product->inumber)
-        {
-        if(*ipointer >= RADIX)
+        while(ipointer >= product->inumber)
             {
-            LONG karry = *ipointer / RADIX;
-            *ipointer %= RADIX;
-            --ipointer;
-            assert(ipointer >= product->inumber);
-            *ipointer += karry;
+            if(*ipointer >= RADIX)
+                {
+                LONG karry = *ipointer / RADIX;
+                *ipointer %= RADIX;
+                --ipointer;
+                assert(ipointer >= product->inumber);
+                *ipointer += karry;
+                }
+            else
+                --ipointer;
             }
-        else
-            --ipointer;
         }
 
     for(ipointer = product->inumber; product->ilength > 1 && *ipointer == 0; ++ipointer)
@@ -944,31 +1650,154 @@ static void convert2binary(nnumber* x)
 
 static char* isplit(Qnumber _qget, nnumber* ptel, nnumber* pnoem)
     {
-    ptel->sign = _qget->v.fl & (MINUS | QNUL);
-    pnoem->sign = 0;
-    pnoem->alloc = ptel->alloc = NULL;
-    ptel->number = (char*)POBJ(_qget);
-    if(_qget->v.fl & QFRACTION)
+    char* on = split(_qget, ptel, pnoem);
+    if(!recallBinary(_qget, ptel, pnoem))
         {
-        char* on = strchr(ptel->number, '/');
-        assert(on);
-        ptel->length = on - ptel->number;
-        pnoem->number = on + 1;
-        pnoem->length = strlen(on + 1);
         convert2binary(ptel);
         convert2binary(pnoem);
-        return on;
         }
-    else
+    return on;
+    }
+
+/* Sets the limbs of num and den, which must have been made by split().
+   Returns TRUE if num/den is known to be in lowest terms. The results of
+   operations are, and only these are in the binary cache, but numbers that
+   are read as text need not be: 4/6 stays 4/6 until it is used. */
+static int lowestTerms(Qnumber _qget, nnumber* num, nnumber* den)
+    {
+    if(recallBinary(_qget, num, den))
+        return TRUE;
+    convert2binary(num);
+    convert2binary(den);
+    return !(_qget->v.fl & QFRACTION) || coprime(num, den);
+    }
+
+/* lowestTerms() for both operands of a binary operation. If both are short,
+   the gcd would cost more than the reduced operation saves, so the operands
+   are only converted and the old path is taken. */
+static int bothLowestTerms(Qnumber _qx, nnumber* xt, nnumber* xn, Qnumber _qy, nnumber* yt, nnumber* yn)
+    {
+    int reduced;
+    if((size_t)xt->length + 1 + (size_t)xn->length < BINARYMINLENGTH
+       && (size_t)yt->length + 1 + (size_t)yn->length < BINARYMINLENGTH
+       )
         {
-        assert(!(_qget->v.fl & QFRACTION));
-        ptel->length = strlen(ptel->number);
-        pnoem->number = "1";
-        pnoem->length = 1;
-        convert2binary(ptel);
-        convert2binary(pnoem);
-        return NULL;
+        convert2binary(xt);
+        convert2binary(xn);
+        convert2binary(yt);
+        convert2binary(yn);
+        return FALSE;
+        }
+    reduced = lowestTerms(_qx, xt, xn);
+    return lowestTerms(_qy, yt, yn) && reduced;
+    }
+
+/* x1/x2 * y1/y2 for fractions in lowest terms. After dividing x1 and y2 by
+   their gcd and y1 and x2 by theirs, the product is in lowest terms. These
+   gcds are of shorter numbers than the gcd of the products. */
+static Qnumber qTimesReduced(nnumber* x1, nnumber* x2, nnumber* y1, nnumber* y2)
+    {
+    nnumber g = { 0 }, h = { 0 }, a = { 0 }, b = { 0 }, c = { 0 }, d = { 0 }, num = { 0 }, den = { 0 };
+    Qnumber res;
+    if((x1->sign | y1->sign) & QNUL)
+        return copyof(&zeroNode);
+    else if((x2->sign | y2->sign) & QNUL)
+        return not_a_number();
+    nGcd(x1, y2, &g);
+    nDivideExactly(x1, &g, &a);
+    nDivideExactly(y2, &g, &d);
+    nGcd(y1, x2, &h);
+    nDivideExactly(y1, &h, &c);
+    nDivideExactly(x2, &h, &b);
+    nTimes(&a, &c, &num);
+    nTimes(&b, &d, &den);
+    res = nn2q(&num, &den);
+    bfree(g.ialloc);
+    bfree(h.ialloc);
+    bfree(a.ialloc);
+    bfree(b.ialloc);
+    bfree(c.ialloc);
+    bfree(d.ialloc);
+    bfree(num.ialloc);
+    bfree(den.ialloc);
+    return res;
+    }
+
+/*
+Small integers.
+
+Most numbers in a program are counters, indices and lengths. For these the
+conversion of the text to limbs and of the limbs back to text costs more than
+the operation itself. Integers with at most SMALLDIGITS digits are therefore
+read into an int64_t and the result is written directly into a new node. Sums
+and differences of such integers cannot overflow. Products can, and then the
+operation is done with nnumbers as before.
+
+{?} 0:?i&0:?s&0:?m&whl'(1+!i:<1000000:?i&!s+!i*!i:?s&mod$(!i,7)+!m:?m&div$(!i,3):?d)
+    5.37 s before, 2.23 s now
+*/
+#define SMALLDIGITS 18 /* 10^18 < 2^63 / 2 */
+
+#if defined __GNUC__ && __GNUC__ >= 5 || defined __clang__
+#define smallMultiplyOverflows(x, y, p) __builtin_mul_overflow(x, y, p)
+#else
+static int smallMultiplyOverflows(int64_t x, int64_t y, int64_t* p)
+    {
+    uint64_t ux = (uint64_t)(x < 0 ? -x : x);
+    uint64_t uy = (uint64_t)(y < 0 ? -y : y);
+    uint64_t up = ux * uy;
+    if(ux != 0 && (up / ux != uy || up > (uint64_t)INT64_MAX))
+        return TRUE;
+    *p = (x < 0) == (y < 0) ? (int64_t)up : -(int64_t)up;
+    return FALSE;
+    }
+#endif
+
+static int smallInteger(Qnumber _qx, int64_t* val)
+    {
+    const char* s;
+    int64_t v = 0;
+    int n;
+    if(_qx->v.fl & QFRACTION)
+        return FALSE;
+    for(s = (char*)POBJ(_qx), n = 0; s[n]; ++n)
+        {
+        if(n == SMALLDIGITS)
+            return FALSE;
+        v = 10 * v + (s[n] - '0');
         }
+    *val = (_qx->v.fl & MINUS) ? -v : v;
+    return TRUE;
+    }
+
+static Qnumber smallIntegerNode(int64_t val)
+    {
+    char digits[24];
+    char* d = digits + sizeof(digits);
+    uint64_t u = (uint64_t)(val < 0 ? -val : val);
+    size_t len;
+    Qnumber res;
+    do
+        {
+        *--d = (char)('0' + u % 10);
+        u /= 10;
+        } while(u);
+    len = (size_t)(digits + sizeof(digits) - d);
+    res = (psk)bmalloc(offsetof(sk, u.obj) + 1 + len);
+    memcpy((void*)POBJ(res), d, len);
+    res->v.fl = READY | SUCCESS | QNUMBER BITWISE_OR_SELFMATCHING;
+    res->v.fl |= val < 0 ? MINUS : val == 0 ? QNUL : 0;
+    return res;
+    }
+
+/* Rounds down if y > 0 and up if y < 0, so that the remainder x - y * q is
+   never negative. */
+static int64_t smallIntegerDivision(int64_t x, int64_t y)
+    {
+    int64_t q = x / y;
+    if(x % y < 0)
+        q += y < 0 ? 1 : -1;
+    return q;
     }
 
 
@@ -977,9 +1806,16 @@ Qnumber qTimes(Qnumber _qx, Qnumber _qy)
     Qnumber res;
     nnumber xt = { 0 }, xn = { 0 }, yt = { 0 }, yn = { 0 };
     char* xb, * yb;
+    int64_t x, y, p;
+
+    int reduced;
 
-    xb = isplit(_qx, &xt, &xn);
-    yb = isplit(_qy, &yt, &yn);
+    if(smallInteger(_qx, &x) && smallInteger(_qy, &y) && !smallMultiplyOverflows(x, y, &p))
+        return smallIntegerNode(p);
+
+    xb = split(_qx, &xt, &xn);
+    yb = split(_qy, &yt, &yn);
+    reduced = bothLowestTerms(_qx, &xt, &xn, _qy, &yt, &yn);
     if(!xb && !yb)
         {
         nnumber g = { 0 };
@@ -994,7 +1830,7 @@ Qnumber qTimes(Qnumber _qx, Qnumber _qy)
         }
     else
         {
-        res = qDivideMultiply(&xt, &xn, &yt, &yn);
+        res = reduced ? qTimesReduced(&xt, &xn, &yt, &yn) : qDivideMultiply(&xt, &xn, &yt, &yn);
         bfree(xt.ialloc);
         bfree(xn.ialloc);
         bfree(yt.ialloc);
@@ -1007,9 +1843,11 @@ Qnumber qqDivide(Qnumber _qx, Qnumber _qy)
     {
     nnumber xt = { 0 }, xn = { 0 }, yt = { 0 }, yn = { 0 };
     char* xb, * yb;
+    int reduced;
 
-    xb = isplit(_qx, &xt, &xn);
-    yb = isplit(_qy, &yt, &yn);
+    xb = split(_qx, &xt, &xn);
+    yb = split(_qy, &yt, &yn);
+    reduced = bothLowestTerms(_qx, &xt, &xn, _qy, &yt, &yn);
     if(!xb && !yb)
         {
         Qnumber res = qnDivide(&xt, &yt);
@@ -1022,7 +1860,7 @@ Qnumber qqDivide(Qnumber _qx, Qnumber _qy)
     else
         {
         Qnumber res;
-        res = qDivideMultiply(&xt, &xn, &yn, &yt);
+        res = reduced ? qTimesReduced(&xt, &xn, &yn, &yt) : qDivideMultiply(&xt, &xn, &yn, &yt);
         bfree(xt.ialloc);
         bfree(xn.ialloc);
         bfree(yt.ialloc);
@@ -1203,11 +2041,54 @@ void nnSPlus(nnumber* x, nnumber* y, nnumber* som)
     }
 
 
+/* x1/x2 + y1/y2 for fractions in lowest terms. If g = gcd(x2, y2), the
+   numerator t = x1*(y2/g) + y1*(x2/g) of the sum has no factor in common with
+   (x2/g)*(y2/g), so only gcd(t, g) remains to be divided out. (Henrici, see
+   Knuth, TAOCP vol. 2, 4.5.1.) In a sum of many fractions, g is usually much
+   shorter than the denominators. */
+static Qnumber qPlusReduced(nnumber* x1, nnumber* x2, nnumber* y1, nnumber* y2)
+    {
+    nnumber g = { 0 }, xg = { 0 }, yg = { 0 }, pa = { 0 }, pb = { 0 }, t = { 0 };
+    Qnumber res;
+    nGcd(x2, y2, &g);
+    nDivideExactly(x2, &g, &xg);
+    nDivideExactly(y2, &g, &yg);
+    nTimes(x1, &yg, &pa);
+    nTimes(y1, &xg, &pb);
+    nnSPlus(&pa, &pb, &t);
+    bfree(pa.ialloc);
+    bfree(pb.ialloc);
+    bfree(yg.ialloc);
+    if(t.sign & QNUL)
+        res = copyof(&zeroNode);
+    else
+        {
+        nnumber h = { 0 }, num = { 0 }, yh = { 0 }, den = { 0 };
+        nGcd(&t, &g, &h);
+        nDivideExactly(&t, &h, &num);
+        nDivideExactly(y2, &h, &yh);
+        nTimes(&xg, &yh, &den);
+        res = nn2q(&num, &den);
+        bfree(h.ialloc);
+        bfree(num.ialloc);
+        bfree(yh.ialloc);
+        bfree(den.ialloc);
+        }
+    bfree(t.ialloc);
+    bfree(xg.ialloc);
+    bfree(g.ialloc);
+    return res;
+    }
+
 Qnumber qPlus(Qnumber _qx, Qnumber _qy, int minus)
     {
     nnumber xt = { 0 }, xn = { 0 }, yt = { 0 }, yn = { 0 };
+    int64_t x, y;
 
     char* xb, * yb;
+    if(smallInteger(_qx, &x) && smallInteger(_qy, &y))
+        return smallIntegerNode(minus ? x - y : x + y);
+
     xb = split(_qx, &xt, &xn);
     yb = split(_qy, &yt, &yn);
     yt.sign ^= minus;
@@ -1222,10 +2103,15 @@ Qnumber qPlus(Qnumber _qx, Qnumber _qy, int minus)
         {
         nnumber pa = { 0 }, pb = { 0 }, som = { 0 };
         Qnumber res;
-        convert2binary(&xt);
-        convert2binary(&xn);
-        convert2binary(&yt);
-        convert2binary(&yn);
+        if(bothLowestTerms(_qx, &xt, &xn, _qy, &yt, &yn))
+            {
+            res = qPlusReduced(&xt, &xn, &yt, &yn);
+            bfree(xt.ialloc);
+            bfree(xn.ialloc);
+            bfree(yt.ialloc);
+            bfree(yn.ialloc);
+            return res;
+            }
         nTimes(&xt, &yn, &pa);
         nTimes(&yt, &xn, &pb);
         nnSPlus(&pa, &pb, &som);
@@ -1252,6 +2138,10 @@ Qnumber qIntegerDivision(Qnumber _qx, Qnumber _qy)
     {
     Qnumber res, aqnumber;
     nnumber xt = { 0 }, xn = { 0 }, yt = { 0 }, yn = { 0 }, p1 = { 0 }, p2 = { 0 }, quotient = { 0 }, remainder = { 0 };
+    int64_t x, y;
+
+    if(smallInteger(_qx, &x) && smallInteger(_qy, &y))
+        return smallIntegerNode(smallIntegerDivision(x, y));
 
     isplit(_qx, &xt, &xn);
     isplit(_qy, &yt, &yn);
@@ -1284,6 +2174,10 @@ Qnumber qIntegerDivision(Qnumber _qx, Qnumber _qy)
 Qnumber qModulo(Qnumber _qx, Qnumber _qy)
     {
     Qnumber res, _q2, _q3;
+    int64_t x, y;
+
+    if(smallInteger(_qx, &x) && smallInteger(_qy, &y))
+        return smallIntegerNode(x - y * smallIntegerDivision(x, y));
 
     _q2 = qIntegerDivision(_qx, _qy);
     _q3 = qTimes(_qy, _q2);
@@ -1314,6 +2208,9 @@ int qCompare(Qnumber _qx, Qnumber _qy)
     {
     Qnumber som;
     int res;
+    int64_t x, y;
+    if(smallInteger(_qx, &x) && smallInteger(_qy, &y))
+        return x < y ? MINUS : x == y ? QNUL : 0;
     som = qPlus(_qx, _qy, MINUS);
     res = som->v.fl & (MINUS | QNUL);
     pskfree(som);
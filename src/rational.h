@@ -15,5 +15,6 @@ Qnumber qTimes(Qnumber _qx, Qnumber _qy);
 Qnumber qIntegerDivision(Qnumber _qx, Qnumber _qy);
 Qnumber qTimesMinusOne(Qnumber _qx);
 int subroot(nnumber* ag, char* conc[], int* pind);
+void releaseBinaryNumbers(void);
 
 #endif
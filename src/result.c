@@ -17,11 +17,11 @@ static void hreslts(psk Root, int level, int ind, int space, psk cutoff);
 
 
 #define COMPLEX_MAX 80
-int LineLength = NARROWLINELENGTH;
+THREADLOCAL int LineLength = NARROWLINELENGTH;
 
 static size_t complexity(psk Root, size_t max)
     {
-    static int Parent, Child;
+    static THREADLOCAL int Parent, Child;
     while(is_op(Root))
         {
         max += 2; /* Each time reslt is called, level is incremented by 1.
@@ -74,7 +74,7 @@ static size_t complexity(psk Root, size_t max)
     return max;
     }
 
-static int indtel = 0, extraSpc = 0, number_of_flags_on_node = 0;
+static THREADLOCAL int indtel = 0, extraSpc = 0, number_of_flags_on_node = 0;
 
 static int indent(psk Root, int level, int ind)
     {
@@ -187,7 +187,7 @@ static int printflags(psk Root)
 #define RHS 2
 
 #if SHOWWHETHERNEVERVISITED
-Boolean vis = FALSE;
+THREADLOCAL Boolean vis = FALSE;
 #define SM(Root) if(vis && !(Root->v.fl & VISITED)) { (*process)('{'); (*process)('}'); }
 #else
 #define SM(Root)
@@ -294,7 +294,7 @@ static void endnode(psk Root, int space)
 #ifndef reslt
 static void reslt(psk Root, int level, int ind, int space)
     {
-    static int Parent, Child, newind;
+    static THREADLOCAL int Parent, Child, newind;
     while(is_op(Root))
         {
         if(Op(Root) == EQUALS)
@@ -344,7 +344,7 @@ static void reslt(psk Root, int level, int ind, int space)
 
 static void reslts(psk Root, int level, int ind, int space, psk cutoff)
     {
-    static int Parent, Child, newind;
+    static THREADLOCAL int Parent, Child, newind;
     if(is_op(Root))
         {
         if(Op(Root) == EQUALS)
@@ -399,7 +399,7 @@ static void reslts(psk Root, int level, int ind, int space, psk cutoff)
 
 static void parenthesised_result(psk Root, int level, int ind, int space)
     {
-    static int Parent, Child;
+    static THREADLOCAL int Parent, Child;
     if(is_op(Root))
         {
         int number_of_flags;
@@ -450,7 +450,7 @@ static void parenthesised_result(psk Root, int level, int ind, int space)
 #if DEBUGBRACMAT
 static void hreslts(psk Root, int level, int ind, int space, psk cutoff)
     {
-    static int Parent, Child;
+    static THREADLOCAL int Parent, Child;
     if(is_op(Root))
         {
         int number_of_flags;
@@ -6,7 +6,7 @@
 void result(psk Root);
 void results(psk Root, psk cutoff);
 #if (1 && SHOWWHETHERNEVERVISITED)
-extern Boolean vis = FALSE;
+extern THREADLOCAL Boolean vis;
 #endif
 
 #endif
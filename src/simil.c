@@ -1,6 +1,7 @@
 #include "simil.h"
 #include "platformdependentdefs.h"
 #include "encoding.h"
+#include "memory.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -88,12 +89,106 @@ static LONG simil
     return max;
     }
 
+/*
+Returns the characters of s in lower case, or NULL if s is not valid UTF-8.
+In the latter case simil() decides per character whether to read UTF-8 or
+bytes, so only simil() can give the same result.
+*/
+static int* lowerCodePoints(const char* s, LONG* plen)
+    {
+    const char* p = s;
+    int* cps;
+    LONG len;
+    int K;
+    for(len = 0; (K = getCodePoint(&p)) > 0; ++len)
+        ;
+    if(K < 0)
+        return NULL;
+    cps = (int*)bmalloc((size_t)(len + 1) * sizeof(int));
+    for(len = 0; (K = getCodePoint(&s)) > 0; ++len)
+        cps[len] = toLowerUnicode(K);
+    *plen = len;
+    return cps;
+    }
+
+/*
+Same result as simil(), but the longest common substring of a[lo1..hi1> and
+b[lo2..hi2> is found in time proportional to the product of the lengths,
+instead of the product times the length of the common substring.
+row[j] is the length of the common substring that starts at a[i+1] and b[j].
+Among equally long common substrings the one that simil() finds first is
+taken: the one that starts first in a and then first in b.
+*/
+static LONG similArrays(const int* a, LONG lo1, LONG hi1, const int* b, LONG lo2, LONG hi2, LONG* row)
+    {
+    LONG max = 0;
+    LONG maxi = 0;
+    LONG maxj = 0;
+    LONG i;
+    LONG j;
+    if(lo1 >= hi1 || lo2 >= hi2)
+        return 0;
+    for(j = lo2; j <= hi2; ++j)
+        row[j] = 0;
+    for(i = hi1; i-- > lo1;)
+        {
+        LONG rowmax = 0;
+        LONG rowj = 0;
+        int A = a[i];
+        for(j = lo2; j < hi2; ++j)
+            {
+            if(A == b[j])
+                {
+                if((row[j] = row[j + 1] + 1) > rowmax)
+                    {
+                    rowmax = row[j];
+                    rowj = j;
+                    }
+                }
+            else
+                row[j] = 0;
+            }
+        if(rowmax && rowmax >= max)
+            {
+            max = rowmax;
+            maxi = i;
+            maxj = rowj;
+            }
+        }
+    if(max)
+        {
+        max += similArrays(a, lo1, maxi, b, lo2, maxj, row)
+            + similArrays(a, maxi + max, hi1, b, maxj + max, hi2, row);
+        }
+    return max;
+    }
+
+static void sprintSim(char* draft, LONG sim, LONG len1, LONG len2)
+    {
+    sprintf(draft, LONGD "/" LONGD, (2L * (LONG)sim), len1 + len2);
+    }
+
 void Sim(char* draft, char* str1, char* str2)
     {
-    int utf1 = 1;
-    int utf2 = 1;
     LONG len1 = 0;
     LONG len2 = 0;
-    LONG sim = simil(str1, str1 + strlen((char*)str1), str2, str2 + strlen((char*)str2), &utf1, &utf2, &len1, &len2);
-    sprintf(draft, LONGD "/" LONGD, (2L * (LONG)sim), len1 + len2);
+    int* a = lowerCodePoints(str1, &len1);
+    int* b = a ? lowerCodePoints(str2, &len2) : NULL;
+    if(b)
+        {
+        LONG* row = (LONG*)bmalloc((size_t)(len2 + 1) * sizeof(LONG));
+        sprintSim(draft, similArrays(a, 0, len1, b, 0, len2, row), len1, len2);
+        bfree(row);
+        }
+    else
+        {
+        int utf1 = 1;
+        int utf2 = 1;
+        LONG sim = simil(str1, str1 + strlen((char*)str1), str2, str2 + strlen((char*)str2), &utf1, &utf2, &len1, &len2);
+        sprintSim(draft, sim, len1, len2);
+        }
+    if(b)
+        bfree(b);
+    if(a)
+        bfree(a);
     }
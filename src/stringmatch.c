@@ -15,6 +15,18 @@
 #include "filewrite.h"
 #include <assert.h>
 
+#if PREPAREDPATTERNS
+THREADLOCAL unsigned long stringImpliedFences = 0;
+#endif
+
+static void setImpliedFence(psk pat)
+    {
+    pat->v.fl |= IMPLIEDFENCE;
+#if PREPAREDPATTERNS
+    ++stringImpliedFences; /* see preparePattern() in treematch.c */
+#endif
+    }
+
 static int stringOncePattern(psk pat)
     {
     /*
@@ -31,7 +43,7 @@ static int stringOncePattern(psk pat)
         }
     if(pat->v.fl & SATOMFILTERS)
         {
-        pat->v.fl |= IMPLIEDFENCE;
+        setImpliedFence(pat);
         return TRUE;
         }
     else if(pat->v.fl & ATOMFILTERS)
@@ -49,7 +61,7 @@ static int stringOncePattern(psk pat)
         {
         if(!pat->u.obj)
             {
-            pat->v.fl |= IMPLIEDFENCE;
+            setImpliedFence(pat);
             return TRUE;
             }
         else
@@ -67,26 +79,26 @@ static int stringOncePattern(psk pat)
             case EXP:
             case LOG:
             case DIF:
-                pat->v.fl |= IMPLIEDFENCE;
+                setImpliedFence(pat);
                 return TRUE;
             case OR:
                 if(stringOncePattern(pat->LEFT) && stringOncePattern(pat->RIGHT))
                     {
-                    pat->v.fl |= IMPLIEDFENCE;
+                    setImpliedFence(pat);
                     return TRUE;
                     }
                 break;
             case MATCH:
                 if(stringOncePattern(pat->LEFT) || stringOncePattern(pat->RIGHT))
                     {
-                    pat->v.fl |= IMPLIEDFENCE;
+                    setImpliedFence(pat);
                     return TRUE;
                     }
                 break;
             case AND:
                 if(stringOncePattern(pat->LEFT))
                     {
-                    pat->v.fl |= IMPLIEDFENCE;
+                    setImpliedFence(pat);
                     return TRUE;
                     }
                 break;
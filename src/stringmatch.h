@@ -6,6 +6,11 @@
 #include "nodestruct.h"
 #include <stddef.h>
 
+#if PREPAREDPATTERNS
+/* Number of times string matching has set IMPLIEDFENCE in a pattern node. */
+extern THREADLOCAL unsigned long stringImpliedFences;
+#endif
+
 #if CUTOFFSUGGEST
 char stringmatch
 (int ind
@@ -17,6 +17,7 @@
 #include "result.h"
 #include <assert.h>
 #include <string.h>
+#include <stdlib.h>
 
 /*#define SUBJECTNOTNIL(sub,pat) (is_op(sub) || HAS_UNOPS(sub) || (PIOBJ(sub) != PIOBJ(nil(pat))))*/
 #define SUBJECTNOTNIL(sub,pat) (is_op(sub) || HAS_UNOPS(sub) || (PLOBJ(sub) != PLOBJ(nil(pat))))
@@ -79,7 +80,8 @@ static int oncePattern(psk pat)
         return FALSE;
     else if(!is_op(pat))
         {
-        pat->v.fl |= IMPLIEDFENCE;
+        /* Not flagged: the atom may be interned and thereby be shared with
+           string patterns, for which it is no once pattern. */
         return TRUE;
         }
     else
@@ -119,6 +121,267 @@ static int oncePattern(psk pat)
     return FALSE;
     }
 
+/*
+A pattern (w1|w2|...|wn|rest) that starts with at least MINALTERNATIVES atoms
+without prefixes is matched with the help of a hash table that contains these
+atoms. The table is made when the pattern is used for the first time and is
+kept until the top | node is freed (see pskfree()). The atoms only match equal
+atoms, have no side effects and are always ONCE, so the sequential trial of the
+alternatives can be replaced by one lookup, followed by a match against rest if
+no atom matched.
+*/
+#define MINALTERNATIVES 16
+
+typedef struct alternatives
+    {
+    psk pat;   /* the | node, NULL if the slot is empty */
+    psk left;  /* children of pat when the table was made, to detect changes */
+    psk right;
+    psk rest;  /* first alternative that is not an atom, NULL if none */
+    size_t size;
+    psk* atoms;
+    } alternatives;
+
+static THREADLOCAL alternatives* alternativesTable = NULL;
+static THREADLOCAL size_t alternativesSize = 0;
+static THREADLOCAL size_t alternativesCount = 0;
+
+static int plainAtom(psk pat)
+    {
+    return !(pat->v.fl & (VISIBLE_FLAGS | IS_OPERATOR | QNUMBER | QDOUBLE | MINUS | LATEBIND))
+        && pat->u.obj
+        && PLOBJ(pat) != IM;
+    }
+
+static size_t atomHash(const unsigned char* str)
+    {
+    size_t hash = 2166136261UL;
+    for(; *str; ++str)
+        {
+        hash ^= *str;
+        hash *= 16777619UL;
+        }
+    return hash;
+    }
+
+static size_t pointerHash(psk pat)
+    {
+    return ((size_t)pat / sizeof(knode)) * 2654435761UL;
+    }
+
+static alternatives* findAlternatives(psk pat)
+    {
+    size_t mask = alternativesSize - 1;
+    size_t i;
+    for(i = pointerHash(pat) & mask; alternativesTable[i].pat; i = (i + 1) & mask)
+        if(alternativesTable[i].pat == pat)
+            return alternativesTable + i;
+    return NULL;
+    }
+
+static int insertAlternatives(alternatives* alts)
+    {
+    size_t mask;
+    size_t i;
+    if(2 * (alternativesCount + 1) > alternativesSize)
+        {
+        size_t newSize = alternativesSize ? 2 * alternativesSize : 64;
+        alternatives* newTable = (alternatives*)calloc(newSize, sizeof(alternatives));
+        alternatives* a;
+        if(!newTable)
+            return FALSE;
+        mask = newSize - 1;
+        for(a = alternativesTable; a < alternativesTable + alternativesSize; ++a)
+            if(a->pat)
+                {
+                for(i = pointerHash(a->pat) & mask; newTable[i].pat; i = (i + 1) & mask)
+                    ;
+                newTable[i] = *a;
+                }
+        free(alternativesTable);
+        alternativesTable = newTable;
+        alternativesSize = newSize;
+        }
+    mask = alternativesSize - 1;
+    for(i = pointerHash(alts->pat) & mask; alternativesTable[i].pat; i = (i + 1) & mask)
+        ;
+    alternativesTable[i] = *alts;
+    ++alternativesCount;
+    return TRUE;
+    }
+
+/* Called when a | node is freed. */
+void forgetAlternatives(psk pat)
+    {
+    alternatives* alts;
+    size_t mask, i, j;
+    if(!alternativesCount || (alts = findAlternatives(pat)) == NULL)
+        return;
+    free(alts->atoms);
+    /* backward shift deletion */
+    mask = alternativesSize - 1;
+    i = (size_t)(alts - alternativesTable);
+    for(j = (i + 1) & mask; alternativesTable[j].pat; j = (j + 1) & mask)
+        {
+        size_t home = pointerHash(alternativesTable[j].pat) & mask;
+        if(((j - home) & mask) >= ((j - i) & mask))
+            {
+            alternativesTable[i] = alternativesTable[j];
+            i = j;
+            }
+        }
+    alternativesTable[i].pat = NULL;
+    --alternativesCount;
+    }
+
+static alternatives* makeAlternatives(psk pat)
+    {
+    alternatives alts;
+    psk node;
+    size_t n = 0;
+    for(node = pat; Op(node) == OR && plainAtom(node->LEFT); node = node->RIGHT)
+        {
+        if(node != pat && (node->v.fl & VISIBLE_FLAGS))
+            break;
+        ++n;
+        }
+    if(n < MINALTERNATIVES)
+        return NULL;
+    alts.pat = pat;
+    alts.left = pat->LEFT;
+    alts.right = pat->RIGHT;
+    alts.rest = node;
+    if(plainAtom(node))
+        {
+        alts.rest = NULL;
+        ++n;
+        }
+    for(alts.size = 1; alts.size < 2 * n; alts.size <<= 1)
+        ;
+    alts.atoms = (psk*)calloc(alts.size, sizeof(psk));
+    if(!alts.atoms)
+        return NULL;
+    for(node = pat; n--; node = node->RIGHT)
+        {
+        psk atom = (n || alts.rest) ? node->LEFT : node;
+        size_t mask = alts.size - 1;
+        size_t i;
+        for(i = atomHash(POBJ(atom)) & mask; alts.atoms[i]; i = (i + 1) & mask)
+            if(!strcmp((char*)POBJ(alts.atoms[i]), (char*)POBJ(atom)))
+                break;
+        alts.atoms[i] = atom;
+        }
+    if(!insertAlternatives(&alts))
+        {
+        free(alts.atoms);
+        return NULL;
+        }
+    return findAlternatives(pat);
+    }
+
+static int isAlternative(alternatives* alts, psk sub)
+    {
+    size_t mask = alts->size - 1;
+    size_t i;
+    if(is_op(sub) || (sub->v.fl & LATEBIND))
+        return FALSE;
+    for(i = atomHash(POBJ(sub)) & mask; alts->atoms[i]; i = (i + 1) & mask)
+        if(alts->atoms[i] == sub || !strcmp((char*)POBJ(alts->atoms[i]), (char*)POBJ(sub)))
+            return TRUE;
+    return FALSE;
+    }
+
+#if PREPAREDPATTERNS
+/*
+A pattern !var is cleaned by cleanOncePattern() before it is used, because
+string matching may have set IMPLIEDFENCE flags in it that mean something else
+in tree matching. Cleaning, and then finding the flags again, takes time in
+proportion to the size of the pattern, which for a big pattern used in a loop
+can be much more than the time needed for matching itself. Therefore the most
+recently cleaned patterns are remembered. A remembered pattern is not cleaned
+again as long as string matching has not set IMPLIEDFENCE in any node. Each
+remembered pattern is kept alive by a reference, so it is not changed in place.
+*/
+#define PREPAREDSLOTS 16 /* must be a power of 2 */
+
+typedef struct preparedPattern
+    {
+    psk pat;
+    unsigned long stamp; /* stringImpliedFences when pat was cleaned */
+    } preparedPattern;
+
+static THREADLOCAL preparedPattern preparedPatterns[PREPAREDSLOTS];
+
+static void preparePattern(psk pat)
+    {
+    preparedPattern* slot = preparedPatterns + (pointerHash(pat) & (PREPAREDSLOTS - 1));
+    if(slot->pat == pat)
+        {
+        if(slot->stamp == stringImpliedFences)
+            return;
+        }
+    else
+        {
+        psk ref = same_as_w(pat);
+        if(ref != pat) /* no reference left, got a copy */
+            {
+            wipe(ref);
+            cleanOncePattern(pat);
+            return;
+            }
+        if(slot->pat)
+            wipe(slot->pat);
+        slot->pat = pat;
+        }
+    cleanOncePattern(pat);
+    slot->stamp = stringImpliedFences;
+    }
+
+void releasePreparedPatterns(void)
+    {
+    int i;
+    for(i = 0; i < PREPAREDSLOTS; ++i)
+        if(preparedPatterns[i].pat)
+            {
+            wipe(preparedPatterns[i].pat);
+            preparedPatterns[i].pat = NULL;
+            }
+    }
+#else
+#define preparePattern(pat) cleanOncePattern(pat)
+#endif
+
+#if !DEBUGBRACMAT
+#define matchAlternatives(IND,SUB,PAT,SNIJAF,POS,LENGTH,OP) matchAlternatives(SUB,PAT,SNIJAF,POS,LENGTH,OP)
+#endif
+
+/* Returns the value that trying the alternatives one by one would produce
+   for the | node pat, before the flags of pat itself are taken into account.
+   Returns -1 if pat has too few leading atoms. */
+static int matchAlternatives(int ind, psk sub, psk pat, psk cutoff, LONG pposition, psk expr, unsigned int op)
+    {
+    alternatives* alts = alternativesCount ? findAlternatives(pat) : NULL;
+    char ret;
+    if(alts && (alts->left != pat->LEFT || alts->right != pat->RIGHT))
+        {
+        forgetAlternatives(pat);
+        alts = NULL;
+        }
+    if(!alts && (alts = makeAlternatives(pat)) == NULL)
+        return -1;
+    if(isAlternative(alts, sub))
+        return (!alts->rest || oncePattern(alts->rest)) ? (TRUE | ONCE) : TRUE;
+    if(!alts->rest)
+        return ONCE;
+    ret = match(ind + 1, sub, alts->rest, cutoff, pposition, expr, op);
+    if(ret & POSITION_MAX_REACHED)
+        ret &= ~(POSITION_MAX_REACHED | POSITION_ONCE);
+    /* as done for each of the | nodes between pat and rest */
+    if(oncePattern(alts->rest) || (ret & (TRUE | FENCE | ONCE)) == FENCE)
+        ret |= ONCE;
+    return ret;
+    }
+
 char match(int ind, psk sub, psk pat, psk cutoff, LONG pposition, psk expr, unsigned int op)
     {
     /*
@@ -280,7 +543,7 @@ char match(int ind, psk sub, psk pat, psk cutoff, LONG pposition, psk expr, unsi
                     {
                     if((loc = SymbolBinding_w(pat, Flgs & DOUBLY_INDIRECT)) != NULL)
                         {
-                        cleanOncePattern(loc);
+                        preparePattern(loc);
                         s.c.rmr = (char)(match(ind + 1, sub, loc, cutoff, pposition, expr, op) ^ NOTHING(pat));
                         wipe(loc);
                         }
@@ -597,6 +860,15 @@ char match(int ind, psk sub, psk pat, psk cutoff, LONG pposition, psk expr, unsi
                    */
                     break;
                 case OR:
+                    if(plainAtom(pat->LEFT))
+                        {
+                        int ret = matchAlternatives(ind, sub, pat, cutoff, pposition, expr, op);
+                        if(ret != -1)
+                            {
+                            s.c.rmr = (char)ret;
+                            break;
+                            }
+                        }
                     if((s.c.lmr = (char)match(ind + 1, sub, pat->LEFT, cutoff, pposition, expr, op))
                        & (TRUE | FENCE)
                        )
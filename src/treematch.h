@@ -4,5 +4,9 @@
 #include "platformdependentdefs.h"
 
 char match(int ind, psk sub, psk pat, psk cutoff, LONG pposition, psk expr, unsigned int op);
+void forgetAlternatives(psk pat);
+#if PREPAREDPATTERNS
+void releasePreparedPatterns(void);
+#endif
 
 #endif
@@ -4,6 +4,7 @@ Structures created with UnicodeData.bra
 */
 
 #include "unichartypes.h"
+#include "platformdependentdefs.h"
 #include <assert.h>
 
 typedef enum {e1L,e1M,e1N,e1P,e1S,e1Z,e1C,e1} mark1;
@@ -488,7 +489,7 @@ const char * gencat(int a)
     unsigned int offset;
     cletter *Cletters;
     const char *def;
-    static char returnVal[3] = { '\0','\0','\0' };
+    static THREADLOCAL char returnVal[3] = { '\0','\0','\0' };
     
     if(a <= 0)
         return 0;
@@ -36,7 +36,6 @@ typedef struct vars /* sizeof(vars) = n * 4 bytes */
     unsigned char* vname;
 #define VARNAME(x) x->vname
 #endif
-    struct vars* next;
     int n;
     int selector;
     varia* pvaria; /* Can also contain entry[0]   (if n == 0) */
@@ -50,24 +49,186 @@ typedef struct vars /* sizeof(vars) = n * 4 bytes */
 #endif
     } vars;
 
-static vars* variables[256];
+/* Variables are kept in an open addressing hash table with linear probing.
+   Each slot caches the hash value of the variable's name, so that probing
+   past other variables seldom requires comparing strings.
+   The table doubles its size as soon as it would become more than half full.
+   Removal shifts subsequent entries back, so no tombstones are needed. */
+#define VARTABLEMINSIZE 256 /* must be a power of 2 */
 
-static int searchname(psk name,
-                      vars** pprevvar,
-                      vars** pnxtvar)
+typedef struct varslot
+    {
+    ULONG hash;
+    vars* var; /* NULL if slot is empty */
+    } varslot;
+
+static THREADLOCAL varslot* variables = NULL;
+static THREADLOCAL size_t variablesSize = 0;
+static THREADLOCAL size_t variablesCount = 0;
+
+/* Counters, reported by mem$STA */
+static THREADLOCAL ULONG varLookups = 0;
+static THREADLOCAL ULONG varProbes = 0;
+static THREADLOCAL ULONG varLongestProbe = 0;
+static THREADLOCAL ULONG varResizes = 0;
+
+static ULONG varhash(const unsigned char* strng)
+    {
+    /* FNV-1a */
+    ULONG hash = 2166136261UL;
+    for(; *strng; ++strng)
+        {
+        hash ^= *strng;
+        hash *= 16777619UL;
+        }
+    return hash;
+    }
+
+static varslot* allocateVarslots(size_t size)
+    {
+    varslot* slots = (varslot*)malloc(size * sizeof(varslot));
+    if(slots)
+        {
+        size_t i;
+        for(i = 0; i < size; ++i)
+            slots[i].var = NULL;
+        }
+    return slots;
+    }
+
+/* Returns the slot containing the variable, or, if the variable does not exist,
+   the empty slot where the variable would be inserted. */
+static varslot* searchname(psk name, ULONG* phash)
     {
     unsigned char* strng;
-    vars* nxtvar, * prevvar;
+    ULONG hash;
+    size_t mask = variablesSize - 1;
+    size_t i;
+    ULONG probes = 1;
+    varslot* slot;
     strng = POBJ(name);
-    for(prevvar = NULL, nxtvar = variables[*strng]
-        ;  nxtvar && (STRCMP(VARNAME(nxtvar), strng) < 0)
-        ; prevvar = nxtvar, nxtvar = nxtvar->next
+    hash = varhash(strng);
+    for(i = (size_t)hash & mask
+        ; (slot = variables + i)->var != NULL
+        && (slot->hash != hash || STRCMP(VARNAME(slot->var), strng))
+        ; i = (i + 1) & mask
+        )
+        ++probes;
+    ++varLookups;
+    varProbes += probes;
+    if(probes > varLongestProbe)
+        varLongestProbe = probes;
+    if(phash)
+        *phash = hash;
+    return slot;
+    }
+
+static vars* findvar(psk name)
+    {
+    return searchname(name, NULL)->var;
+    }
+
+static void growVariables(void)
+    {
+    size_t newSize = variablesSize << 1;
+    varslot* newvariables = allocateVarslots(newSize);
+    if(newvariables)
+        {
+        size_t mask = newSize - 1;
+        varslot* slot;
+        for(slot = variables; slot < variables + variablesSize; ++slot)
+            {
+            if(slot->var)
+                {
+                size_t i;
+                for(i = (size_t)slot->hash & mask
+                    ; newvariables[i].var
+                    ; i = (i + 1) & mask
+                    )
+                    ;
+                newvariables[i] = *slot;
+                }
+            }
+        free(variables);
+        variables = newvariables;
+        variablesSize = newSize;
+        ++varResizes;
+        }
+    else if(variablesCount + 1 >= variablesSize)
+        {
+        errorprintf("memory full (could not enlarge table of variables)");
+        exit(1);
+        }
+    }
+
+static void addVariable(ULONG hash, vars* newvar)
+    {
+    size_t mask;
+    size_t i;
+    if(2 * (variablesCount + 1) > variablesSize)
+        growVariables();
+    mask = variablesSize - 1;
+    for(i = (size_t)hash & mask
+        ; variables[i].var
+        ; i = (i + 1) & mask
         )
         ;
-    /* prevvar < strng <= nxtvar */
-    *pprevvar = prevvar;
-    *pnxtvar = nxtvar;
-    return nxtvar && !STRCMP(VARNAME(nxtvar), strng);
+    variables[i].hash = hash;
+    variables[i].var = newvar;
+    ++variablesCount;
+    }
+
+static void removeVariable(varslot* slot)
+    {
+    size_t mask = variablesSize - 1;
+    size_t i = (size_t)(slot - variables);
+    size_t j = i;
+    for(;;)
+        {
+        size_t home;
+        j = (j + 1) & mask;
+        if(variables[j].var == NULL)
+            break;
+        home = (size_t)variables[j].hash & mask;
+        /* Leave the entry where it is if its home slot is cyclically in (i,j] */
+        if(i <= j ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        variables[i] = variables[j];
+        i = j;
+        }
+    variables[i].var = NULL;
+    --variablesCount;
+    }
+
+static void freevar(vars* var)
+    {
+#if PVNAME
+    if(var->vname != OBJ(nilNode))
+        bfree(var->vname);
+#endif
+    bfree(var);
+    }
+
+static int varcmp(const void* a, const void* b)
+    {
+    return STRCMP(VARNAME((*(vars* const*)a)), VARNAME((*(vars* const*)b)));
+    }
+
+/* Returns malloc'ed array with all variables, sorted by name. */
+static vars** sortedVariables(void)
+    {
+    vars** sorted = (vars**)malloc((variablesCount + 1) * sizeof(vars*));
+    if(sorted)
+        {
+        varslot* slot;
+        size_t n = 0;
+        for(slot = variables; slot < variables + variablesSize; ++slot)
+            if(slot->var)
+                sorted[n++] = slot->var;
+        qsort(sorted, n, sizeof(vars*), varcmp);
+        sorted[n] = NULL;
+        }
+    return sorted;
     }
 
 /*
@@ -218,7 +379,6 @@ int update(psk name, psk pnode) /* name = tree with DOT in root */
 */
     {
     vars* nxtvar;
-    vars* prevvar;
     if(is_op(name->LEFT))
         {
         if(Op(name->LEFT) == EQUALS)
@@ -237,9 +397,7 @@ int update(psk name, psk pnode) /* name = tree with DOT in root */
         name->RIGHT = same_as_w(pnode);
         return TRUE;
         }
-    else if(searchname(name->LEFT,
-                       &prevvar,
-                       &nxtvar))
+    else if((nxtvar = findvar(name->LEFT)) != NULL)
         {
         assert(nxtvar->pvaria);
         return setmember(name->RIGHT, Entry2(nxtvar->n, nxtvar->selector, nxtvar->pvaria), pnode);
@@ -253,7 +411,9 @@ int update(psk name, psk pnode) /* name = tree with DOT in root */
 
 int insert(psk name, psk pnode)
     {
-    vars* nxtvar, * prevvar, * newvar;
+    varslot* slot;
+    vars* newvar;
+    ULONG hash;
 
     if(is_op(name))
         {
@@ -268,11 +428,11 @@ int insert(psk name, psk pnode)
             return update(name, pnode); /*{?} (borfo=klot=)&bk:?(borfo klot)&!(borfo.klot):bk => bk */
             }
         }
-    if(searchname(name,
-                  &prevvar,
-                  &nxtvar))
+    slot = searchname(name, &hash);
+    if(slot->var)
         {
         ppsk PPnode;
+        vars* nxtvar = slot->var;
         wipe(*(PPnode = Entry(nxtvar->n, nxtvar->selector, &nxtvar->pvaria)));
         *PPnode = same_as_w(pnode);
         }
@@ -317,14 +477,10 @@ int insert(psk name, psk pnode)
             newvar->u.Lobj = LOBJ(nilNode);
 #endif
             }
-        newvar->next = nxtvar;
-        if(prevvar == NULL)
-            variables[*strng] = newvar;
-        else
-            prevvar->next = newvar;
         newvar->n = 0;
         newvar->selector = 0;
         newvar->pvaria = (varia*)same_as_w(pnode);
+        addVariable(hash, newvar); /* invalidates slot */
         }
     return TRUE;
     }
@@ -332,7 +488,8 @@ int insert(psk name, psk pnode)
 int psh(psk name, psk pnode, psk dim)
     {
     /* string must fulfill requirements of icpy */
-    vars* nxtvar, * prevvar;
+    varslot* slot;
+    vars* nxtvar;
     varia* nvaria;
     psk cnode;
     int oldn, n, m2, m22;
@@ -348,22 +505,20 @@ int psh(psk name, psk pnode, psk dim)
         }
     if(dim && !INTEGER(dim))
         return FALSE;
-    if(!searchname(name,
-                   &prevvar,
-                   &nxtvar))
+    slot = searchname(name, NULL);
+    if(!slot->var)
         {
         insert(name, pnode);
         if(dim)
             {
-            searchname(name,
-                       &prevvar,
-                       &nxtvar);
+            slot = searchname(name, NULL);
             }
         else
             {
             return TRUE;
             }
         }
+    nxtvar = slot->var;
     n = oldn = nxtvar->n;
     if(dim)
         {
@@ -418,15 +573,8 @@ int psh(psk name, psk pnode, psk dim)
             }
         if(nxtvar->n < 0)
             {
-            if(prevvar)
-                prevvar->next = nxtvar->next;
-            else
-                variables[*POBJ(name)] = nxtvar->next;
-#if PVNAME
-            if(nxtvar->vname != OBJ(nilNode))
-                bfree(nxtvar->vname);
-#endif
-            bfree(nxtvar);
+            removeVariable(searchname(name, NULL)); /* wipe may have moved slot */
+            freevar(nxtvar);
             return TRUE;
             }
         }
@@ -441,11 +589,9 @@ int psh(psk name, psk pnode, psk dim)
 
 int deleteNode(psk name)
     {
-    vars* nxtvar, * prevvar;
+    vars* nxtvar;
     varia* hv;
-    if(searchname(name,
-                  &prevvar,
-                  &nxtvar))
+    if((nxtvar = findvar(name)) != NULL)
         {
         psk tmp;
         assert(nxtvar->pvaria);
@@ -465,15 +611,8 @@ int deleteNode(psk name)
             }
         else
             {
-            if(prevvar)
-                prevvar->next = nxtvar->next;
-            else
-                variables[*POBJ(name)] = nxtvar->next;
-#if PVNAME
-            if(nxtvar->vname != OBJ(nilNode))
-                bfree(nxtvar->vname);
-#endif
-            bfree(nxtvar);
+            removeVariable(searchname(name, NULL)); /* wipe may have moved slot */
+            freevar(nxtvar);
             }
         return TRUE;
         }
@@ -495,11 +634,8 @@ psk getValueByVariableName(psk namenode)
     {
     vars* nxtvar;
     assert(!is_op(namenode));
-    for(nxtvar = variables[namenode->u.obj];
-        nxtvar && (STRCMP(VARNAME(nxtvar), POBJ(namenode)) < 0);
-        nxtvar = nxtvar->next)
-        ;
-    if(nxtvar && !STRCMP(VARNAME(nxtvar), POBJ(namenode))
+    nxtvar = findvar(namenode);
+    if(nxtvar
        && nxtvar->selector <= nxtvar->n
        )
         {
@@ -805,98 +941,126 @@ int copy_insert(psk name, psk pnode, psk cutoff)
     return ret;
     }
 
+static psk variableStatistics(psk pnode)
+    {
+    char draft[256];
+    sprintf(draft
+            , "(variables." LONGU ") (slots." LONGU ") (lookups." LONGU ") (probes." LONGU ") (longest." LONGU ") (resizes." LONGU ")"
+            , (ULONG)variablesCount
+            , (ULONG)variablesSize
+            , varLookups
+            , varProbes
+            , varLongestProbe
+            , varResizes
+    );
+    return build_up(pnode, draft, internStatistics(), memoryStatistics(), NULL);
+    }
+
 void mmf(ppsk PPnode)
     {
     psk goal;
     ppsk pgoal;
     vars* nxtvar;
-    int alphabet, ext;
+    vars** sorted;
+    vars** pvar;
+    int ext;
     char dim[22];
+    if(search_opt(*PPnode, STA))
+        {
+        *PPnode = variableStatistics(*PPnode);
+        return;
+        }
     ext = search_opt(*PPnode, EXT);
     wipe(*PPnode);
     pgoal = PPnode;
-    for(alphabet = 0; alphabet < 256/*0x80*/; alphabet++)
+    sorted = sortedVariables();
+    for(pvar = sorted; pvar && (nxtvar = *pvar) != NULL; ++pvar)
         {
-        for(nxtvar = variables[alphabet];
-            nxtvar;
-            nxtvar = nxtvar->next)
+        goal = *pgoal = (psk)bmalloc(sizeof(knode));
+        goal->v.fl = WHITE | SUCCESS;
+        if(ext && nxtvar->n > 0)
             {
-            goal = *pgoal = (psk)bmalloc(sizeof(knode));
-            goal->v.fl = WHITE | SUCCESS;
-            if(ext && nxtvar->n > 0)
+            goal = goal->LEFT = (psk)bmalloc(sizeof(knode));
+            goal->v.fl = DOT | SUCCESS;
+            sprintf(dim, "%d.%d", nxtvar->n, nxtvar->selector);
+            goal->RIGHT = NULL;
+            goal->RIGHT = build_up(goal->RIGHT, dim, NULL);
+            }
+        goal = goal->LEFT =
+            (psk)bmalloc(sizeof(ULONG) + 1 + strlen((char*)VARNAME(nxtvar)));
+        goal->v.fl = (READY | SUCCESS);
+        strcpy((char*)(goal)+sizeof(ULONG), (char*)VARNAME(nxtvar));
+        pgoal = &(*pgoal)->RIGHT;
+        }
+    free(sorted);
+    *pgoal = same_as_w(&nilNode);
+    }
+
+static void lstvar(vars* nxtvar)
+    {
+    int n;
+    for(n = nxtvar->n; n >= 0; n--)
+        {
+        ppsk tmp;
+        if(listWithName)
+            {
+            if(global_fpo == stdout)
                 {
-                goal = goal->LEFT = (psk)bmalloc(sizeof(knode));
-                goal->v.fl = DOT | SUCCESS;
-                sprintf(dim, "%d.%d", nxtvar->n, nxtvar->selector);
-                goal->RIGHT = NULL;
-                goal->RIGHT = build_up(goal->RIGHT, dim, NULL);
+                if(nxtvar->n > 0)
+                    Printf("%c%d (", n == nxtvar->selector ? '>' : ' ', n);
+                else
+                    Printf("(");
                 }
-            goal = goal->LEFT =
-                (psk)bmalloc(sizeof(ULONG) + 1 + strlen((char*)VARNAME(nxtvar)));
-            goal->v.fl = (READY | SUCCESS);
-            strcpy((char*)(goal)+sizeof(ULONG), (char*)VARNAME(nxtvar));
-            pgoal = &(*pgoal)->RIGHT;
+            if(quote(VARNAME(nxtvar)))
+                myprintf("\"", (char*)VARNAME(nxtvar), "\"=", NULL);
+            else
+                myprintf((char*)VARNAME(nxtvar), "=", NULL);
+            if(hum)
+                myprintf("\n", NULL);
+            }
+        assert(nxtvar->pvaria);
+        tmp = Entry(nxtvar->n, n, &nxtvar->pvaria);
+        result(*tmp = Head(*tmp));
+        if(listWithName)
+            {
+            if(global_fpo == stdout)
+                Printf("\n)");
+            myprintf(";\n", NULL);
             }
+        else
+            break; /*Only list variable on top of stack if RAW*/
         }
-    *pgoal = same_as_w(&nilNode);
     }
 
 static Boolean lstsub(psk pnode)
     {
     vars* nxtvar;
-    unsigned char* name;
-    int alphabet, n;
     Boolean found = FALSE;
     beNice = FALSE;
-    name = POBJ(pnode);
-    for(alphabet = 0; alphabet < 256; alphabet++)
+    if(pnode->u.obj == 0)
         {
-        for(nxtvar = variables[alphabet];
-            nxtvar;
-            nxtvar = nxtvar->next)
+        vars** sorted = sortedVariables();
+        vars** pvar;
+        for(pvar = sorted; pvar && (nxtvar = *pvar) != NULL; ++pvar)
             {
-            if((pnode->u.obj == 0 && alphabet < 0x80) || !STRCMP(VARNAME(nxtvar), name))
+            if(*VARNAME(nxtvar) < 0x80)
                 {
                 found = TRUE;
-                for(n = nxtvar->n; n >= 0; n--)
-                    {
-                    ppsk tmp;
-                    if(listWithName)
-                        {
-                        if(global_fpo == stdout)
-                            {
-                            if(nxtvar->n > 0)
-                                Printf("%c%d (", n == nxtvar->selector ? '>' : ' ', n);
-                            else
-                                Printf("(");
-                            }
-                        if(quote(VARNAME(nxtvar)))
-                            myprintf("\"", (char*)VARNAME(nxtvar), "\"=", NULL);
-                        else
-                            myprintf((char*)VARNAME(nxtvar), "=", NULL);
-                        if(hum)
-                            myprintf("\n", NULL);
-                        }
-                    assert(nxtvar->pvaria);
-                    tmp = Entry(nxtvar->n, n, &nxtvar->pvaria);
-                    result(*tmp = Head(*tmp));
-                    if(listWithName)
-                        {
-                        if(global_fpo == stdout)
-                            Printf("\n)");
-                        myprintf(";\n", NULL);
-                        }
-                    else
-                        break; /*Only list variable on top of stack if RAW*/
-                    }
+                lstvar(nxtvar);
                 }
             }
+        free(sorted);
+        }
+    else if((nxtvar = findvar(pnode)) != NULL)
+        {
+        found = TRUE;
+        lstvar(nxtvar);
         }
     beNice = TRUE;
     return found;
     }
 
-Boolean GoodLST;
+THREADLOCAL Boolean GoodLST;
 
 void lst(psk pnode)
     {
@@ -942,11 +1106,8 @@ function_return_type setIndex(psk Pnode)
         vars* nxtvar;
         if(is_op(rightnode))
             return functionFail(Pnode);
-        for(nxtvar = variables[rightnode->u.obj];
-            nxtvar && (STRCMP(VARNAME(nxtvar), POBJ(rightnode)) < 0);
-            nxtvar = nxtvar->next);
-        /* find first name in a row of equal names */
-        if(nxtvar && !STRCMP(VARNAME(nxtvar), POBJ(rightnode)))
+        nxtvar = findvar(rightnode);
+        if(nxtvar)
             {
             nxtvar->selector =
                 (int)toLong(lnode)
@@ -968,11 +1129,51 @@ function_return_type setIndex(psk Pnode)
     */
     }
 
+#if EVALUATIONARENA
+/* Called at the end of stringEval(). Moves new variables and their values out
+   of the arena. Stacks of values (varia records) stay where they are. */
+void promoteVariables(void)
+    {
+    varslot* slot;
+    for(slot = variables; slot < variables + variablesSize; ++slot)
+        {
+        vars* var = slot->var;
+        if(var)
+            {
+            int i;
+#if !PVNAME
+            if(inArena(var))
+                {
+                size_t len = strlen((char*)VARNAME(var));
+                size_t size = len < sizeof(struct vars) - offsetof(struct vars, u)
+                    ? sizeof(vars)
+                    : (offsetof(struct vars, u) + 1) + len;
+                vars* newvar = (vars*)bmalloc(size);
+                memcpy(newvar, var, size);
+                bfree(var);
+                slot->var = var = newvar;
+                }
+#endif
+            for(i = 0; i <= var->n; ++i)
+                {
+                ppsk ppnode = Entry(var->n, i, &var->pvaria);
+                *ppnode = promoted(*ppnode);
+                }
+            }
+        }
+    }
+#endif
+
 void initVariables(void)
     {
-    int tel;
-    for(tel = 0; tel < 256; variables[tel++] = NULL)
-        ;
+    variablesSize = VARTABLEMINSIZE;
+    variablesCount = 0;
+    variables = allocateVarslots(variablesSize);
+    if(!variables)
+        {
+        errorprintf("memory full (could not allocate table of variables)");
+        exit(1);
+        }
     }
 
 static int scopy_insert(psk name, const char* str)
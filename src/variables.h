@@ -4,7 +4,7 @@
 #include "platformdependentdefs.h"
 #include "typedobjectnode.h"
 
-extern Boolean GoodLST;
+extern THREADLOCAL Boolean GoodLST;
 
 void lst(psk pnode);
 psk Head(psk pnode);
@@ -20,6 +20,9 @@ void mmf(ppsk PPnode);
 int update(psk name, psk pnode); /* name = tree with DOT in root */
 function_return_type setIndex(psk Pnode);
 void initVariables(void);
+#if EVALUATIONARENA
+void promoteVariables(void);
+#endif
 int icopy_insert(psk name, LONG number);
 int string_copy_insert(psk name, psk pnode, char* str, char* cutoff);
 
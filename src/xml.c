@@ -58,12 +58,12 @@ attributes can be empty (no =[valuex])
 #define FALSE 0
 
 typedef enum { notag, tag, endoftag, endoftag_startoftag } estate;
-static estate(*tagState)(const unsigned char* pkar);
+static THREADLOCAL estate(*tagState)(const unsigned char* pkar);
 
 static int Put(const unsigned char* c);
-static int (*xput)(const unsigned char* c) = Put;
+static THREADLOCAL int (*xput)(const unsigned char* c) = Put;
 
-static int assumeUTF8 = 1; /* Turned off when a non-UTF-8 sequence is seen. */
+static THREADLOCAL int assumeUTF8 = 1; /* Turned off when a non-UTF-8 sequence is seen. */
 
 static int rawput(int c)
     {
@@ -114,11 +114,11 @@ struct lowup lu[] =
 
 #define BUFSIZE 35000
 
-static unsigned char* bufx;
-static unsigned char* glob_p;
-static int anychar = FALSE;
+static THREADLOCAL unsigned char* bufx;
+static THREADLOCAL unsigned char* glob_p;
+static THREADLOCAL int anychar = FALSE;
 
-static int (*namechar)(int c);
+static THREADLOCAL int (*namechar)(int c);
 
 static int NameChar(int c)
     {
@@ -2317,8 +2317,8 @@ int compareEntities(const void* a, const void* b)
     return strcmp(((Entity*)a)->ent, ((Entity*)b)->ent);
     }
 
-static int HTvar = 0;
-static int Xvar = 0;
+static THREADLOCAL int HTvar = 0;
+static THREADLOCAL int Xvar = 0;
 static int charref(const unsigned char* c)
     {
     if(*c == ';')
@@ -2432,7 +2432,7 @@ static int Put(const unsigned char* c)
         unsigned char tmp[8];
         if(assumeUTF8)
             {
-            static ptrdiff_t safebytes = 0; /* Number of future bytes that can be safely regarded as part of UTF-8 char. */
+            static THREADLOCAL ptrdiff_t safebytes = 0; /* Number of future bytes that can be safely regarded as part of UTF-8 char. */
             if(*c & 0x40) /* first byte of multibyte char */
                 {
                 const char* d = (const char*)c;
@@ -2496,9 +2496,9 @@ static void nonTag(const char* kind, unsigned char* start, unsigned char* end)
     putOperatorChar(')');
     }
 
-static unsigned char* ch;
-static unsigned char* StaRt = 0;
-static int isMarkup = 0;
+static THREADLOCAL unsigned char* ch;
+static THREADLOCAL unsigned char* StaRt = 0;
+static THREADLOCAL int isMarkup = 0;
 
 static void cbStartMarkUp(void)
     {
@@ -2521,7 +2521,7 @@ static void cbEndDOCTYPE(void)/* called when > has been read */
     nonTagWithoutEntityUnfolding("!DOCTYPE", StaRt, ch);
     }
 
-static unsigned char* endElementName;
+static THREADLOCAL unsigned char* endElementName;
 static void cbEndElementName(void)
     {
     nxput(StaRt, endElementName ? endElementName : ch);
@@ -2542,7 +2542,7 @@ static void cbEndAttribute(void)
     }
 
 static estate def_pcdata(const unsigned char* pkar);
-static estate(*defx)(const unsigned char* pkar) = def_pcdata;
+static THREADLOCAL estate(*defx)(const unsigned char* pkar) = def_pcdata;
 static estate def_cdata(const unsigned char* pkar);
 static estate lt(const unsigned char* pkar);
 static estate lt_cdata(const unsigned char* pkar);
@@ -2665,12 +2665,12 @@ static estate lt_cdata(const unsigned char* pkar)
         }
     }
 
-static int ScriptStyleiMax = 0;
-static int scriptstylei = 0;
-static int scriptstylei2 = 0;
-static int scriptstyleimax = 0;
-static unsigned char* elementEndNameLower;
-static unsigned char* elementEndNameUpper;
+static THREADLOCAL int ScriptStyleiMax = 0;
+static THREADLOCAL int scriptstylei = 0;
+static THREADLOCAL int scriptstylei2 = 0;
+static THREADLOCAL int scriptstyleimax = 0;
+static THREADLOCAL unsigned char* elementEndNameLower;
+static THREADLOCAL unsigned char* elementEndNameUpper;
 static estate scriptOrStyleEndElement(const unsigned char* pkar) /* <sc or <SC or <Sc or <sC or <st or <ST or <St or <sT */
     {
     const int kar = *pkar;
@@ -3224,8 +3224,8 @@ static estate endvalue(const unsigned char* pkar)
     }
 
 
-static unsigned char* elementNameLower;
-static unsigned char* elementNameUpper;
+static THREADLOCAL unsigned char* elementNameLower;
+static THREADLOCAL unsigned char* elementNameUpper;
 static estate scriptOrStyleElement(const unsigned char* pkar) /* <sc or <SC or <Sc or <sC or <st or <ST or <St or <sT */
     {
     const int kar = *pkar;
@@ -3374,7 +3374,7 @@ static estate endPI(const unsigned char* pkar)
         }
     }
 
-static int doctypei = 0;
+static THREADLOCAL int doctypei = 0;
 static estate DOCTYPE1(const unsigned char* pkar) /* <!D */
     {
     const int kar = *pkar;
@@ -3496,7 +3496,7 @@ static estate DOCTYPE10(const unsigned char* pkar)  /* <!DOCTYPE S [ ] */
     }
 
 
-static int cdatai = 0;
+static THREADLOCAL int cdatai = 0;
 static estate CDATA1(const unsigned char* pkar) /* <![ */
     {
     const int kar = *pkar;